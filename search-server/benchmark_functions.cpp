@@ -0,0 +1,923 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+#include "benchmark_functions.h"
+#include "corpus_loader.h"
+#include "duplicate_detector.h"
+
+using namespace std;
+
+namespace {
+
+// Returns time spent in func in milliseconds
+double MeasureMilliseconds(const function<void()> &func) {
+  const auto start = chrono::steady_clock::now();
+  func();
+  const auto finish = chrono::steady_clock::now();
+  return chrono::duration<double, milli>(finish - start).count();
+}
+
+// Allocator counting the bytes requested by a container
+template <typename T> struct CountingAllocator {
+  using value_type = T;
+
+  explicit CountingAllocator(size_t *counter) : counter(counter) {}
+  template <typename U>
+  CountingAllocator(const CountingAllocator<U> &other)
+      : counter(other.counter) {}
+
+  T *allocate(size_t n) {
+    *counter += n * sizeof(T);
+    return allocator<T>().allocate(n);
+  }
+  void deallocate(T *p, size_t n) {
+    *counter -= n * sizeof(T);
+    allocator<T>().deallocate(p, n);
+  }
+  template <typename U>
+  bool operator==(const CountingAllocator<U> &other) const {
+    return counter == other.counter;
+  }
+  template <typename U>
+  bool operator!=(const CountingAllocator<U> &other) const {
+    return counter != other.counter;
+  }
+
+  size_t *counter;
+};
+
+using LegacyPostings =
+    map<int, double, less<int>, CountingAllocator<pair<const int, double>>>;
+
+// The scoring loop of FindAllDocuments without the predicate, works with any
+// index of the form word -> range of (document_id, TF)
+template <typename Index>
+double ScoreQueries(const Index &index, const vector<string> &queries,
+                    int document_count) {
+  double checksum = 0;
+  for (const string &query : queries) {
+    map<int, double> document_to_relevance;
+    for (const string_view word : SplitIntoWords(string_view{query})) {
+      const auto it = index.find(word);
+      if (it == index.end()) {
+        continue;
+      }
+      const double inverse_document_freq =
+          log(document_count * 1.0 / it->second.size());
+      for (const auto [document_id, term_freq] : it->second) {
+        document_to_relevance[document_id] +=
+            term_freq * inverse_document_freq;
+      }
+    }
+    checksum += document_to_relevance.size();
+  }
+  return checksum;
+}
+
+// Fills the server with document_count documents of words from the dictionary
+void AddGeneratedDocuments(mt19937 &generator, SearchServer &search_server,
+                           const vector<string> &dictionary,
+                           int document_count, int word_count) {
+  const auto documents =
+      GenerateQueries(generator, dictionary, document_count, word_count);
+  for (size_t i = 0; i < documents.size(); ++i) {
+    search_server.AddDocument(static_cast<int>(i), documents[i],
+                              DocumentStatus::ACTUAL, {1, 2, 3});
+  }
+}
+
+// Returns latency of every call of func(query) in milliseconds, sorted
+template <typename Func>
+vector<double> MeasureLatencies(const vector<string> &queries, Func func) {
+  vector<double> latencies;
+  latencies.reserve(queries.size());
+  for (const string &query : queries) {
+    latencies.push_back(MeasureMilliseconds([&] { func(query); }));
+  }
+  sort(latencies.begin(), latencies.end());
+  return latencies;
+}
+
+void PrintLatencies(const string &name, const vector<double> &latencies) {
+  const auto percentile = [&latencies](double p) {
+    return latencies[static_cast<size_t>(p * (latencies.size() - 1))];
+  };
+  cout << "  "s << name << ": p50 "s << percentile(0.5) << " ms, p99 "s
+       << percentile(0.99) << " ms"s << endl;
+}
+
+} // namespace
+
+vector<string> GenerateDictionary(mt19937 &generator, int word_count,
+                                  int max_length) {
+  vector<string> words;
+  words.reserve(word_count);
+  for (int i = 0; i < word_count; ++i) {
+    const int length = uniform_int_distribution(1, max_length)(generator);
+    string word;
+    word.reserve(length);
+    for (int j = 0; j < length; ++j) {
+      word.push_back(uniform_int_distribution('a', 'z')(generator));
+    }
+    words.push_back(word);
+  }
+  sort(words.begin(), words.end());
+  words.erase(unique(words.begin(), words.end()), words.end());
+  return words;
+}
+
+string GenerateQuery(mt19937 &generator, const vector<string> &dictionary,
+                     int word_count, double minus_prob) {
+  string query;
+  for (int i = 0; i < word_count; ++i) {
+    if (!query.empty()) {
+      query.push_back(' ');
+    }
+    if (uniform_real_distribution<>(0, 1)(generator) < minus_prob) {
+      query.push_back('-');
+    }
+    query += dictionary[uniform_int_distribution<int>(
+        0, dictionary.size() - 1)(generator)];
+  }
+  return query;
+}
+
+vector<string> GenerateQueries(mt19937 &generator,
+                               const vector<string> &dictionary,
+                               int query_count, int max_word_count) {
+  vector<string> queries;
+  queries.reserve(query_count);
+  for (int i = 0; i < query_count; ++i) {
+    queries.push_back(GenerateQuery(generator, dictionary, max_word_count));
+  }
+  return queries;
+}
+
+void BenchmarkPostingIndex() {
+  mt19937 generator;
+  const auto dictionary = GenerateDictionary(generator, 2'000, 10);
+  const auto queries = GenerateQueries(generator, dictionary, 2'000, 5);
+
+  // The same documents in the write buffer and in compressed segments
+  SearchServer buffered_server(dictionary[0]);
+  buffered_server.SetWriteBufferSize(numeric_limits<size_t>::max());
+  mt19937 buffered_generator = generator;
+  AddGeneratedDocuments(buffered_generator, buffered_server, dictionary,
+                        20'000, 70);
+  SearchServer search_server(dictionary[0]);
+  AddGeneratedDocuments(generator, search_server, dictionary, 20'000, 70);
+  search_server.WaitForMerges();
+
+  // Rebuilding both index layouts from the forward index of the server
+  size_t legacy_bytes = 0;
+  map<string_view, LegacyPostings> legacy_index;
+  unordered_map<string_view, PostingList> index;
+  size_t posting_count = 0;
+  for (const int document_id : search_server) {
+    for (const auto &[word, term_freq] :
+         search_server.GetWordFrequencies(document_id)) {
+      auto it = legacy_index.find(word);
+      if (it == legacy_index.end()) {
+        it = legacy_index
+                 .emplace(word, LegacyPostings(CountingAllocator<
+                                               pair<const int, double>>(
+                                    &legacy_bytes)))
+                 .first;
+      }
+      it->second.emplace(document_id, term_freq);
+      index[word].Add(document_id, term_freq);
+      ++posting_count;
+    }
+  }
+  const size_t buffer_bytes = buffered_server.GetPostingsMemoryUsage();
+  const size_t segment_bytes = search_server.GetPostingsMemoryUsage();
+
+  cout << "Posting index: "s << posting_count << " postings"s << endl;
+  cout << "  map<int, double> nodes: "s
+       << static_cast<double>(legacy_bytes) / posting_count
+       << " bytes per posting (without allocator overhead)"s << endl;
+  cout << "  PostingList: "s
+       << static_cast<double>(buffer_bytes) / posting_count
+       << " bytes per posting"s << endl;
+  cout << "  compressed segments: "s
+       << static_cast<double>(segment_bytes) / posting_count
+       << " bytes per posting, "s << search_server.GetSegmentCount()
+       << " segments, "s << static_cast<double>(buffer_bytes) / segment_bytes
+       << "x smaller"s << endl;
+
+  const int document_count = search_server.GetDocumentCount();
+  double checksum = 0;
+  const double legacy_ms = MeasureMilliseconds([&] {
+    checksum += ScoreQueries(legacy_index, queries, document_count);
+  });
+  const double index_ms = MeasureMilliseconds(
+      [&] { checksum += ScoreQueries(index, queries, document_count); });
+  const double buffered_ms = MeasureMilliseconds([&] {
+    for (const string &query : queries) {
+      checksum += buffered_server.FindTopDocuments(query).size();
+    }
+  });
+  const double server_ms = MeasureMilliseconds([&] {
+    for (const string &query : queries) {
+      checksum += search_server.FindTopDocuments(query).size();
+    }
+  });
+  cout << "  map<int, double> scoring: "s << legacy_ms << " ms"s << endl;
+  cout << "  PostingList scoring: "s << index_ms << " ms, speedup "s
+       << legacy_ms / index_ms << "x"s << endl;
+  cout << "  FindTopDocuments, write buffer: "s << buffered_ms << " ms"s
+       << endl;
+  cout << "  FindTopDocuments, compressed segments: "s << server_ms << " ms"s
+       << endl;
+  // Keeps the measured loops from being optimized away
+  if (checksum < 0) {
+    cout << checksum << endl;
+  }
+}
+
+void BenchmarkRelevanceAccumulator() {
+  mt19937 generator;
+  // A small dictionary makes every query word a common one
+  const auto dictionary = GenerateDictionary(generator, 200, 10);
+  const auto queries = GenerateQueries(generator, dictionary, 1'000, 3);
+  SearchServer search_server(""s);
+  AddGeneratedDocuments(generator, search_server, dictionary, 50'000, 30);
+
+  unordered_map<string_view, PostingList> index;
+  for (const int document_id : search_server) {
+    for (const auto &[word, term_freq] :
+         search_server.GetWordFrequencies(document_id)) {
+      index[word].Add(document_id, term_freq);
+    }
+  }
+  const int document_count = search_server.GetDocumentCount();
+  const auto score = [&](const string &query, auto &&accumulate) {
+    for (const string_view word : SplitIntoWords(string_view{query})) {
+      const PostingList &postings = index.at(word);
+      const double inverse_document_freq =
+          log(document_count * 1.0 / postings.size());
+      for (const auto [ordinal, term_freq] : postings) {
+        accumulate(ordinal, term_freq * inverse_document_freq);
+      }
+    }
+  };
+
+  double checksum = 0;
+  cout << "Relevance accumulation, "s << document_count
+       << " documents, common-word queries:"s << endl;
+  PrintLatencies("map<int, double>"s,
+                 MeasureLatencies(queries, [&](const string &query) {
+                   map<int, double> document_to_relevance;
+                   score(query, [&](int ordinal, double relevance) {
+                     document_to_relevance[ordinal] += relevance;
+                   });
+                   checksum += document_to_relevance.size();
+                 }));
+  PrintLatencies("RelevanceAccumulator"s,
+                 MeasureLatencies(queries, [&](const string &query) {
+                   RelevanceAccumulator &accumulator = GetThreadAccumulator();
+                   accumulator.Reset(0, document_count);
+                   score(query, [&](int ordinal, double relevance) {
+                     accumulator.Add(ordinal, relevance);
+                   });
+                   accumulator.ForEachMatched(
+                       [&](int, double relevance) { checksum += relevance; });
+                 }));
+  PrintLatencies("FindTopDocuments"s,
+                 MeasureLatencies(queries, [&](const string &query) {
+                   checksum += search_server.FindTopDocuments(query).size();
+                 }));
+  if (checksum < 0) {
+    cout << checksum << endl;
+  }
+}
+
+void BenchmarkParallelScoring() {
+  mt19937 generator;
+  // Two-word queries over a small dictionary: few query words, each with a
+  // long posting list
+  const auto dictionary = GenerateDictionary(generator, 100, 10);
+  const auto queries = GenerateQueries(generator, dictionary, 100, 2);
+  SearchServer search_server(""s);
+  AddGeneratedDocuments(generator, search_server, dictionary, 200'000, 20);
+
+  double checksum = 0;
+  const double sequential_ms = MeasureMilliseconds([&] {
+    for (const string &query : queries) {
+      checksum += search_server.FindTopDocuments(execution::seq, query).size();
+    }
+  });
+  cout << "Parallel scoring, "s << search_server.GetDocumentCount()
+       << " documents, two-word queries, "s << thread::hardware_concurrency()
+       << " hardware threads:"s << endl;
+  cout << "  sequential: "s << sequential_ms << " ms"s << endl;
+  for (size_t concurrency = 1; concurrency <= 32; concurrency *= 2) {
+    search_server.SetScoringConcurrency(concurrency);
+    const double parallel_ms = MeasureMilliseconds([&] {
+      for (const string &query : queries) {
+        checksum +=
+            search_server.FindTopDocuments(execution::par, query).size();
+      }
+    });
+    cout << "  "s << concurrency << " threads: "s << parallel_ms
+         << " ms, speedup "s << sequential_ms / parallel_ms << "x"s << endl;
+  }
+  if (checksum < 0) {
+    cout << checksum << endl;
+  }
+}
+
+void BenchmarkDuplicateDetection() {
+  mt19937 generator;
+  const auto dictionary = GenerateDictionary(generator, 1000, 10);
+  SearchServer search_server(""s);
+  AddGeneratedDocuments(generator, search_server, dictionary, 200'000, 8);
+  // Every fifth document repeats an earlier one with the words shuffled
+  const int document_count = search_server.GetDocumentCount();
+  for (int id = 0; id < document_count; id += 5) {
+    const auto word_freqs = search_server.GetWordFrequencies(id);
+    vector<string> words;
+    for (const auto &[word, _] : word_freqs) {
+      words.emplace_back(word);
+    }
+    shuffle(words.begin(), words.end(), generator);
+    string text;
+    for (const string &word : words) {
+      text += word + " "s;
+    }
+    text.pop_back();
+    search_server.AddDocument(document_count + id, text,
+                              DocumentStatus::ACTUAL, {1});
+  }
+
+  size_t legacy_count = 0;
+  const double legacy_ms = MeasureMilliseconds([&] {
+    set<set<string_view>> unique_documents;
+    for (const int document_id : search_server) {
+      const auto word_freqs = search_server.GetWordFrequencies(document_id);
+      set<string_view> words;
+      for (const auto &[word, _] : word_freqs) {
+        words.insert(word);
+      }
+      legacy_count += !unique_documents.insert(words).second;
+    }
+  });
+  size_t exact_count = 0;
+  const double exact_ms = MeasureMilliseconds(
+      [&] { exact_count = FindDuplicates(search_server).size(); });
+  size_t near_count = 0;
+  const double near_ms = MeasureMilliseconds(
+      [&] { near_count = FindDuplicates(search_server, 0.8).size(); });
+
+  cout << "Duplicate detection, "s << search_server.GetDocumentCount()
+       << " documents:"s << endl;
+  cout << "  set of word sets: "s << legacy_ms << " ms, "s << legacy_count
+       << " duplicates"s << endl;
+  cout << "  hashed word sets: "s << exact_ms << " ms, "s << exact_count
+       << " duplicates"s << endl;
+  cout << "  MinHash, similarity 0.8: "s << near_ms << " ms, "s << near_count
+       << " duplicates"s << endl;
+}
+
+void BenchmarkSnapshot() {
+  mt19937 generator;
+  const auto dictionary = GenerateDictionary(generator, 10'000, 10);
+  const auto documents = GenerateQueries(generator, dictionary, 200'000, 20);
+  SearchServer search_server(""s);
+  const double build_ms = MeasureMilliseconds([&] {
+    for (size_t i = 0; i < documents.size(); ++i) {
+      search_server.AddDocument(static_cast<int>(i), documents[i],
+                                DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+  });
+  const string path = "benchmark.snapshot"s;
+  const double save_ms =
+      MeasureMilliseconds([&] { search_server.SaveSnapshot(path); });
+  SearchServer loaded(""s);
+  const double load_ms =
+      MeasureMilliseconds([&] { loaded.LoadSnapshot(path); });
+  const auto queries = GenerateQueries(generator, dictionary, 100, 3);
+  size_t mismatches = 0;
+  for (const string &query : queries) {
+    mismatches += search_server.FindTopDocuments(query).size() !=
+                  loaded.FindTopDocuments(query).size();
+  }
+  remove(path.c_str());
+  cout << "Snapshot, "s << documents.size() << " documents:"s << endl;
+  cout << "  AddDocument: "s << build_ms << " ms"s << endl;
+  cout << "  SaveSnapshot: "s << save_ms << " ms"s << endl;
+  cout << "  LoadSnapshot: "s << load_ms << " ms, "s << mismatches
+       << " mismatching queries"s << endl;
+}
+
+void BenchmarkMutationLog() {
+  mt19937 generator;
+  const auto dictionary = GenerateDictionary(generator, 10'000, 10);
+  const int thread_count = 4;
+  const int documents_per_thread = 5'000;
+  const auto documents = GenerateQueries(
+      generator, dictionary, thread_count * documents_per_thread, 20);
+  const string path = "benchmark.wal"s;
+
+  cout << "Mutation log, "s << documents.size() << " AddDocument calls from "s
+       << thread_count << " threads:"s << endl;
+  const auto measure = [&](const string &name,
+                           shared_ptr<MutationLog> mutation_log) {
+    SearchServer search_server(""s);
+    search_server.SetMutationLog(mutation_log);
+    const double ms = MeasureMilliseconds([&] {
+      vector<thread> threads;
+      for (int t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&, t] {
+          for (int i = t; i < static_cast<int>(documents.size());
+               i += thread_count) {
+            search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL,
+                                      {1, 2, 3});
+          }
+        });
+      }
+      for (thread &worker : threads) {
+        worker.join();
+      }
+      if (mutation_log) {
+        mutation_log->Sync();
+      }
+    });
+    cout << "  "s << name << ": "s << ms << " ms, "s
+         << documents.size() / ms * 1000 << " documents/s"s << endl;
+    search_server.SetMutationLog(nullptr);
+    remove(path.c_str());
+  };
+  measure("no log"s, nullptr);
+  for (const auto &[name, durability] :
+       {pair{"sync per operation"s, LogDurability::EVERY_OPERATION},
+        pair{"sync per batch"s, LogDurability::EVERY_BATCH},
+        pair{"sync on timer"s, LogDurability::TIMER}}) {
+    MutationLogOptions options;
+    options.durability = durability;
+    measure(name, make_shared<MutationLog>(path, options));
+  }
+}
+
+void BenchmarkBulkIngestion() {
+  mt19937 generator;
+  const auto dictionary = GenerateDictionary(generator, 10'000, 10);
+  const auto texts = GenerateQueries(generator, dictionary, 200'000, 20);
+  vector<NewDocument> documents;
+  documents.reserve(texts.size());
+  for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+    documents.push_back({id, texts[id], DocumentStatus::ACTUAL, {1, 2, 3}});
+  }
+
+  cout << "Bulk ingestion, "s << documents.size() << " documents:"s << endl;
+  const auto measure = [&](const string &name, const auto &add) {
+    SearchServer search_server("and in on"s);
+    const double ms = MeasureMilliseconds([&] { add(search_server); });
+    cout << "  "s << name << ": "s << ms << " ms, "s
+         << documents.size() / ms * 1000 << " documents/s"s << endl;
+  };
+  measure("AddDocument loop"s, [&](SearchServer &search_server) {
+    for (const NewDocument &document : documents) {
+      search_server.AddDocument(document.id, document.text, document.status,
+                                document.ratings);
+    }
+  });
+  measure("AddDocuments seq"s, [&](SearchServer &search_server) {
+    search_server.AddDocuments(execution::seq, documents);
+  });
+  measure("AddDocuments par"s, [&](SearchServer &search_server) {
+    search_server.AddDocuments(execution::par, documents);
+  });
+}
+
+void BenchmarkSegments() {
+  mt19937 generator;
+  const auto dictionary = GenerateDictionary(generator, 10'000, 10);
+  const int document_count = 200'000;
+  const auto texts =
+      GenerateQueries(generator, dictionary, document_count * 3 / 2, 20);
+  const auto queries = GenerateQueries(generator, dictionary, 1'000, 3);
+  // Half of the documents are replaced
+  vector<int> removed(document_count / 2);
+  for (int &id : removed) {
+    id = uniform_int_distribution<int>(0, document_count - 1)(generator);
+  }
+
+  cout << "Segmented index, "s << document_count << " documents, "s
+       << removed.size() << " removals and additions:"s << endl;
+  for (const auto &[name, buffer_postings] :
+       {pair{"single write buffer"s, numeric_limits<size_t>::max()},
+        pair{"segments"s, size_t{1} << 16}}) {
+    SearchServer search_server(""s);
+    search_server.SetWriteBufferSize(buffer_postings);
+    const double ingest_ms = MeasureMilliseconds([&] {
+      for (int id = 0; id < document_count; ++id) {
+        search_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL,
+                                  {1, 2, 3});
+      }
+      search_server.WaitForMerges();
+    });
+    double checksum = 0;
+    const auto run_queries = [&] {
+      return MeasureMilliseconds([&] {
+        for (const string &query : queries) {
+          checksum +=
+              search_server.FindTopDocuments(execution::seq, query).size();
+        }
+      });
+    };
+    const double fresh_ms = run_queries();
+    const double churn_ms = MeasureMilliseconds([&] {
+      for (size_t i = 0; i < removed.size(); ++i) {
+        search_server.RemoveDocument(removed[i]);
+        const int id = document_count + static_cast<int>(i);
+        search_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL,
+                                  {1, 2, 3});
+      }
+      search_server.WaitForMerges();
+    });
+    const double churned_ms = run_queries();
+    cout << "  "s << name << ": ingest "s << ingest_ms << " ms, churn "s
+         << churn_ms << " ms, "s << queries.size() << " queries "s
+         << fresh_ms << " ms fresh, "s << churned_ms
+         << " ms after churn, "s << search_server.GetSegmentCount()
+         << " segments, "s
+         << search_server.GetStorageStats().posting_bytes_held / 1024
+         << " KiB of postings"s << endl;
+    if (checksum < 0) {
+      cout << checksum << endl;
+    }
+  }
+}
+
+void BenchmarkTokenizer() {
+  mt19937 generator;
+  const auto dictionary = GenerateDictionary(generator, 10'000, 10);
+  const auto texts = GenerateQueries(generator, dictionary, 200'000, 40);
+  size_t bytes = 0;
+  for (const string &text : texts) {
+    bytes += text.size();
+  }
+
+  cout << "Tokenisation, "s << texts.size() << " documents, "s
+       << bytes / 1024 << " KiB:"s << endl;
+  size_t checksum = 0;
+  vector<string_view> words;
+  const double byte_ms = MeasureMilliseconds([&] {
+    // The split of SplitIntoWordsNoStop before the fused tokeniser
+    for (string_view text : texts) {
+      words.clear();
+      while (true) {
+        const size_t space = text.find(' ');
+        const string_view word = text.substr(0, space);
+        if (any_of(word.begin(), word.end(),
+                   [](char c) { return c >= '\0' && c < ' '; })) {
+          throw invalid_argument("Special symbols"s);
+        }
+        words.push_back(word);
+        if (space == text.npos) {
+          break;
+        }
+        text.remove_prefix(space + 1);
+      }
+      checksum += words.size();
+    }
+  });
+  cout << "  find and none_of: "s << byte_ms << " ms"s << endl;
+  for (const TokenizerKernel kernel : GetSupportedTokenizerKernels()) {
+    const double ms = MeasureMilliseconds([&] {
+      for (const string &text : texts) {
+        words.clear();
+        if (!TokenizeText(text, words, kernel)) {
+          throw invalid_argument("Special symbols"s);
+        }
+        checksum += words.size();
+      }
+    });
+    const char *name = kernel == TokenizerKernel::SCALAR ? "scalar"
+                       : kernel == TokenizerKernel::SSE2 ? "SSE2"
+                                                         : "AVX2";
+    cout << "  "s << name << ": "s << ms << " ms, speedup "s << byte_ms / ms
+         << "x"s << endl;
+  }
+  if (checksum == 0) {
+    cout << checksum << endl;
+  }
+}
+
+void BenchmarkCorpusFile() {
+  mt19937 generator;
+  const auto dictionary = GenerateDictionary(generator, 10'000, 10);
+  const auto texts = GenerateQueries(generator, dictionary, 200'000, 20);
+  const string path =
+      (filesystem::temp_directory_path() / "search_server_corpus.txt")
+          .string();
+  {
+    ofstream out(path, ios::binary | ios::trunc);
+    for (const string &text : texts) {
+      out << text << '\n';
+    }
+  }
+  const double megabytes =
+      static_cast<double>(filesystem::file_size(path)) / (1 << 20);
+
+  cout << "Corpus file, "s << texts.size() << " documents, "s << megabytes
+       << " MiB:"s << endl;
+  const auto measure = [&](const string &name, const auto &add) {
+    SearchServer search_server("and in on"s);
+    const double ms = MeasureMilliseconds([&] { add(search_server); });
+    cout << "  "s << name << ": "s << ms << " ms, "s
+         << megabytes / ms * 1000 << " MiB/s"s << endl;
+  };
+  measure("getline and AddDocument"s, [&](SearchServer &search_server) {
+    ifstream in(path, ios::binary);
+    int id = 0;
+    for (string line; getline(in, line);) {
+      search_server.AddDocument(id++, line, DocumentStatus::ACTUAL, {});
+    }
+  });
+  measure("AddDocumentsFromFile"s, [&](SearchServer &search_server) {
+    AddDocumentsFromFile(search_server, path);
+  });
+  remove(path.c_str());
+}
+
+void BenchmarkResultCache() {
+  mt19937 generator;
+  const auto dictionary = GenerateDictionary(generator, 10'000, 10);
+  const auto texts = GenerateQueries(generator, dictionary, 50'000, 20);
+  const auto queries = GenerateQueries(generator, dictionary, 10'000, 3);
+  // Half of the requests repeat the top 1% of the queries
+  vector<size_t> requests(100'000);
+  for (size_t &request : requests) {
+    request = uniform_int_distribution<size_t>(0, 1)(generator) == 0
+                  ? uniform_int_distribution<size_t>(0, 99)(generator)
+                  : uniform_int_distribution<size_t>(0, 9'999)(generator);
+  }
+  SearchServer search_server("and in on"s);
+  for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+    search_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL,
+                              {1, 2, 3});
+  }
+
+  cout << "Result cache, "s << requests.size() << " requests, half of them "s
+       << "to 1% of "s << queries.size() << " queries:"s << endl;
+  double checksum = 0;
+  const auto measure = [&](const string &name, size_t cache_size,
+                           size_t update_period) {
+    search_server.SetResultCacheSize(cache_size);
+    int next_id = static_cast<int>(texts.size());
+    const double ms = MeasureMilliseconds([&] {
+      for (size_t i = 0; i < requests.size(); ++i) {
+        if (update_period > 0 && i % update_period == 0) {
+          search_server.AddDocument(next_id++, queries[i % queries.size()],
+                                    DocumentStatus::ACTUAL, {1});
+        }
+        checksum +=
+            search_server.FindTopDocuments(queries[requests[i]]).size();
+      }
+    });
+    const ResultCache::Stats stats = search_server.GetResultCacheStats();
+    cout << "  "s << name << ": "s << ms << " ms"s;
+    if (cache_size > 0) {
+      cout << ", hit rate "s
+           << static_cast<double>(stats.hits) / (stats.hits + stats.misses);
+    }
+    cout << endl;
+  };
+  measure("no cache"s, 0, 0);
+  measure("cache of 1000"s, 1'000, 0);
+  measure("cache of 1000, update every 1000 requests"s, 1'000, 1'000);
+  if (checksum < 0) {
+    cout << checksum << endl;
+  }
+}
+
+void BenchmarkRequiredWords() {
+  mt19937 generator;
+  // Every document mixes common and rare words, so the queries pair a long
+  // posting list with a short one
+  const auto common = GenerateDictionary(generator, 50, 10);
+  const auto rare = GenerateDictionary(generator, 10'000, 10);
+  SearchServer search_server("and in on"s);
+  vector<NewDocument> documents;
+  const auto texts = GenerateQueries(generator, common, 100'000, 10);
+  const auto rare_texts = GenerateQueries(generator, rare, 100'000, 5);
+  vector<string> joined(texts.size());
+  for (size_t i = 0; i < texts.size(); ++i) {
+    joined[i] = texts[i] + " "s + rare_texts[i];
+    documents.push_back({static_cast<int>(i), joined[i],
+                         DocumentStatus::ACTUAL, {1, 2, 3}});
+  }
+  search_server.AddDocuments(execution::par, documents);
+  search_server.WaitForMerges();
+
+  vector<pair<string, string>> words;
+  for (int i = 0; i < 1'000; ++i) {
+    words.emplace_back(GenerateQuery(generator, common, 1),
+                       GenerateQuery(generator, rare, 1));
+  }
+  cout << "Common and rare word, "s << words.size() << " queries over "s
+       << documents.size() << " documents:"s << endl;
+  const auto measure = [&](const string &name, const string &format) {
+    size_t results = 0;
+    const double ms = MeasureMilliseconds([&] {
+      for (const auto &[common_word, rare_word] : words) {
+        string query = format;
+        query.replace(query.find('A'), 1, common_word);
+        query.replace(query.find('B'), 1, rare_word);
+        results += search_server
+                       .FindTopDocuments(execution::seq, query,
+                                         DocumentStatus::ACTUAL, 1'000)
+                       .size();
+      }
+    });
+    cout << "  "s << name << ": "s << ms << " ms, "s << results
+         << " results"s << endl;
+  };
+  measure("any word"s, "A B"s);
+  measure("both words"s, "+A +B"s);
+  measure("phrase"s, "\"A B\""s);
+}
+
+void BenchmarkDynamicPruning() {
+  mt19937 generator;
+  // Word frequencies of natural text follow Zipf's law, uniform words with
+  // documents of one length are the worst case, where nothing is pruned
+  auto dictionary = GenerateDictionary(generator, 20'000, 10);
+  shuffle(dictionary.begin(), dictionary.end(), generator);
+  vector<double> weights(dictionary.size());
+  for (size_t i = 0; i < weights.size(); ++i) {
+    weights[i] = 1.0 / (i + 1);
+  }
+  discrete_distribution<size_t> zipf(weights.begin(), weights.end());
+  const auto generate_text = [&](int word_count) {
+    string text;
+    for (int i = 0; i < word_count; ++i) {
+      text += dictionary[zipf(generator)] + " "s;
+    }
+    return text;
+  };
+  SearchServer zipf_server("and in on"s);
+  for (int id = 0; id < 100'000; ++id) {
+    zipf_server.AddDocument(
+        id, generate_text(uniform_int_distribution(5, 60)(generator)),
+        DocumentStatus::ACTUAL, {1, 2, 3});
+  }
+  vector<string> zipf_queries;
+  for (int i = 0; i < 1'000; ++i) {
+    zipf_queries.push_back(
+        generate_text(uniform_int_distribution(2, 5)(generator)));
+  }
+  SearchServer uniform_server("and in on"s);
+  const auto uniform_dictionary = GenerateDictionary(generator, 2'000, 10);
+  AddGeneratedDocuments(generator, uniform_server, uniform_dictionary,
+                        100'000, 20);
+  const auto uniform_queries =
+      GenerateQueries(generator, uniform_dictionary, 1'000, 4);
+  zipf_server.WaitForMerges();
+  uniform_server.WaitForMerges();
+
+  const auto measure = [](const string &name, SearchServer &search_server,
+                          const vector<string> &queries) {
+    cout << name << ", "s << queries.size() << " queries over 100000 "s
+         << "documents:"s << endl;
+    for (const size_t result_count : {5, 100}) {
+      for (const bool pruning : {false, true}) {
+        search_server.SetDynamicPruning(pruning);
+        size_t results = 0;
+        const double ms = MeasureMilliseconds([&] {
+          for (const string &query : queries) {
+            results += search_server
+                           .FindTopDocuments(execution::seq, query,
+                                             DocumentStatus::ACTUAL,
+                                             result_count)
+                           .size();
+          }
+        });
+        cout << "  top "s << result_count
+             << (pruning ? ", pruned: "s : ", exhaustive: "s) << ms
+             << " ms, "s << results << " results"s << endl;
+      }
+    }
+  };
+  measure("Zipf distributed words"s, zipf_server, zipf_queries);
+  measure("Uniform words, documents of 20 words"s, uniform_server,
+          uniform_queries);
+}
+
+void BenchmarkScorers() {
+  mt19937 generator;
+  const auto dictionary = GenerateDictionary(generator, 5'000, 10);
+  SearchServer search_server("and in on"s);
+  // Documents of up to 60 words, so length norms of BM25 differ
+  AddGeneratedDocuments(generator, search_server, dictionary, 100'000, 60);
+  const auto queries = GenerateQueries(generator, dictionary, 1'000, 4);
+  search_server.WaitForMerges();
+
+  const auto measure = [&](const string &name, auto find) {
+    for (const bool pruning : {false, true}) {
+      search_server.SetDynamicPruning(pruning);
+      size_t results = 0;
+      const double ms = MeasureMilliseconds([&] {
+        for (const string &query : queries) {
+          results += find(query).size();
+        }
+      });
+      cout << "  "s << name << (pruning ? ", pruned: "s : ", exhaustive: "s)
+           << ms << " ms, "s << results << " results"s << endl;
+    }
+  };
+  cout << queries.size() << " queries over 100000 documents, top 5:"s
+       << endl;
+  measure("TF-IDF"s, [&](const string &query) {
+    return search_server.FindTopDocuments(execution::seq, query);
+  });
+  measure("BM25"s, [&](const string &query) {
+    return search_server.FindTopDocuments<Bm25Scorer>(execution::seq, query);
+  });
+}
+
+void BenchmarkDocumentFilter() {
+  mt19937 generator;
+  const auto dictionary = GenerateDictionary(generator, 2'000, 10);
+  const auto documents = GenerateQueries(generator, dictionary, 100'000, 30);
+  SearchServer search_server("and in on"s);
+  for (size_t i = 0; i < documents.size(); ++i) {
+    search_server.AddDocument(
+        static_cast<int>(i), documents[i],
+        static_cast<DocumentStatus>(uniform_int_distribution(0, 3)(generator)),
+        {uniform_int_distribution(-10, 10)(generator)});
+  }
+  const auto queries = GenerateQueries(generator, dictionary, 1'000, 4);
+  search_server.WaitForMerges();
+
+  DocumentFilter rating_filter;
+  rating_filter.min_rating = 5;
+  const auto measure = [&](const string &name, auto find) {
+    size_t results = 0;
+    const double ms = MeasureMilliseconds([&] {
+      for (const string &query : queries) {
+        results += find(query).size();
+      }
+    });
+    cout << "  "s << name << ": "s << ms << " ms, "s << results
+         << " results"s << endl;
+  };
+  cout << queries.size() << " queries over 100000 documents, top 5:"s
+       << endl;
+  for (const bool pruning : {false, true}) {
+    search_server.SetDynamicPruning(pruning);
+    cout << (pruning ? " pruned"s : " exhaustive"s) << endl;
+    measure("status predicate"s, [&](const string &query) {
+      return search_server.FindTopDocuments(
+          execution::seq, query, [](int, DocumentStatus status, int) {
+            return status == DocumentStatus::ACTUAL;
+          });
+    });
+    measure("status filter"s, [&](const string &query) {
+      return search_server.FindTopDocuments(execution::seq, query,
+                                            DocumentStatus::ACTUAL);
+    });
+    measure("rating predicate"s, [&](const string &query) {
+      return search_server.FindTopDocuments(
+          execution::seq, query, [](int, DocumentStatus status, int rating) {
+            return status == DocumentStatus::ACTUAL && rating >= 5;
+          });
+    });
+    measure("rating filter"s, [&](const string &query) {
+      return search_server.FindTopDocuments(execution::seq, query,
+                                            rating_filter);
+    });
+  }
+}
+
+void RunBenchmarks() {
+  BenchmarkPostingIndex();
+  BenchmarkRelevanceAccumulator();
+  BenchmarkParallelScoring();
+  BenchmarkDuplicateDetection();
+  BenchmarkSnapshot();
+  BenchmarkMutationLog();
+  BenchmarkBulkIngestion();
+  BenchmarkSegments();
+  BenchmarkTokenizer();
+  BenchmarkCorpusFile();
+  BenchmarkResultCache();
+  BenchmarkRequiredWords();
+  BenchmarkDynamicPruning();
+  BenchmarkScorers();
+  BenchmarkDocumentFilter();
+}
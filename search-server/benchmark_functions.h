@@ -0,0 +1,82 @@
+#pragma once
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "search_server.h"
+
+// Helpers that build a synthetic corpus for the benchmarks
+std::vector<std::string> GenerateDictionary(std::mt19937 &generator,
+                                            int word_count, int max_length);
+std::string GenerateQuery(std::mt19937 &generator,
+                          const std::vector<std::string> &dictionary,
+                          int word_count, double minus_prob = 0);
+std::vector<std::string>
+GenerateQueries(std::mt19937 &generator,
+                const std::vector<std::string> &dictionary, int query_count,
+                int max_word_count);
+
+// Compares the posting-list index with the node-based
+// map<word, map<document_id, TF>> index it replaced: memory per posting and
+// time spent scoring the same queries
+void BenchmarkPostingIndex();
+
+// Per-query latency of scoring common-word queries into map<int, double>
+// versus the dense RelevanceAccumulator
+void BenchmarkRelevanceAccumulator();
+
+// Time of parallel FindTopDocuments on two-word queries with long posting
+// lists for growing number of scoring threads, compared to the sequential one
+void BenchmarkParallelScoring();
+
+// Time of RemoveDuplicates' old set of word sets versus hashed word sets and
+// the MinHash near-duplicate search on a corpus with repeated documents
+void BenchmarkDuplicateDetection();
+
+// Time of rebuilding an index with AddDocument versus saving it and loading
+// the snapshot back
+void BenchmarkSnapshot();
+
+// Throughput of concurrent AddDocument calls without a mutation log and with
+// every durability mode of the log
+void BenchmarkMutationLog();
+
+// Time of indexing a corpus with an AddDocument loop versus sequential and
+// parallel AddDocuments
+void BenchmarkBulkIngestion();
+
+// Ingestion, churn and query time of an index kept in one write buffer
+// versus one sealed into merged segments
+void BenchmarkSegments();
+
+// Time of splitting a corpus into words and checking them for special
+// characters with the find and none_of scans versus every tokeniser kernel
+void BenchmarkTokenizer();
+
+// Throughput of indexing a corpus file read line by line into AddDocument
+// versus the mapped, pipelined AddDocumentsFromFile
+void BenchmarkCorpusFile();
+
+// Time of a skewed query stream without and with the result cache, and the
+// hit rate of the cache with and without interleaved updates
+void BenchmarkResultCache();
+
+// Time of pairs of a common and a rare word searched as any of the words,
+// as required words intersected by galloping cursors and as a phrase
+void BenchmarkRequiredWords();
+
+// Time of top-K queries scoring every document of the query words versus
+// skipping the documents dynamic pruning rules out
+void BenchmarkDynamicPruning();
+
+// Time of the same queries ranked by TF-IDF and by BM25, exhaustive and
+// with dynamic pruning
+void BenchmarkScorers();
+
+// Time of status and rating filters given as predicates versus as
+// DocumentFilter evaluated against the status bitmaps and columns
+void BenchmarkDocumentFilter();
+
+// Runs every benchmark, results are printed to std::cout
+void RunBenchmarks();
@@ -0,0 +1,263 @@
+#include <algorithm>
+#include <array>
+#include <utility>
+
+#include "compressed_postings.h"
+
+namespace {
+
+using UnpackKernel = void (*)(const uint32_t *packed, uint32_t *values);
+
+unsigned GetBitWidth(uint32_t value) {
+  unsigned bits = 0;
+  for (; value != 0; value >>= 1) {
+    ++bits;
+  }
+  return bits;
+}
+
+// Value 4 * k + lane is bits [k * bits, (k + 1) * bits) of the lane, word w
+// of the lane is packed[4 * w + lane]
+void PackLanes(const uint32_t *values, unsigned bits, uint32_t *packed) {
+  // Values of zero width take no words at all
+  if (bits == 0) {
+    return;
+  }
+  for (unsigned k = 0; k < CompressedPostings::BLOCK_SIZE / 4; ++k) {
+    const unsigned word = k * bits / 32;
+    const unsigned shift = k * bits % 32;
+    for (unsigned lane = 0; lane < 4; ++lane) {
+      const uint32_t value = values[4 * k + lane];
+      packed[4 * word + lane] |= value << shift;
+      if (shift + bits > 32) {
+        packed[4 * (word + 1) + lane] |= value >> (32 - shift);
+      }
+    }
+  }
+}
+
+// The width is a template argument, so every shift is a constant once the
+// loop is unrolled and the lanes go in one vector register
+template <unsigned Bits>
+void UnpackLanes(const uint32_t *__restrict packed,
+                 uint32_t *__restrict values) {
+  if constexpr (Bits == 0) {
+    std::fill(values, values + CompressedPostings::BLOCK_SIZE, 0);
+  } else if constexpr (Bits == 32) {
+    // Lanes of full width are the values in order
+    std::copy(packed, packed + CompressedPostings::BLOCK_SIZE, values);
+  } else {
+    const uint32_t mask = (1u << Bits) - 1;
+#pragma GCC unroll 32
+    for (unsigned k = 0; k < CompressedPostings::BLOCK_SIZE / 4; ++k) {
+      const unsigned word = k * Bits / 32;
+      const unsigned shift = k * Bits % 32;
+#pragma GCC unroll 4
+      for (unsigned lane = 0; lane < 4; ++lane) {
+        uint32_t value = packed[4 * word + lane] >> shift;
+        if (shift + Bits > 32) {
+          value |= packed[4 * (word + 1) + lane] << (32 - shift);
+        }
+        values[4 * k + lane] = value & mask;
+      }
+    }
+  }
+}
+
+template <size_t... Bits>
+constexpr std::array<UnpackKernel, sizeof...(Bits)>
+MakeUnpackKernels(std::index_sequence<Bits...>) {
+  return {&UnpackLanes<Bits>...};
+}
+
+// index - bit width
+const std::array<UnpackKernel, 33> UNPACK_KERNELS =
+    MakeUnpackKernels(std::make_index_sequence<33>());
+
+// Partial blocks pack values one after another from first_bit on
+void PackRow(const uint32_t *values, size_t count, unsigned bits,
+             size_t first_bit, uint32_t *packed) {
+  if (bits == 0) {
+    return;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    const size_t bit = first_bit + i * bits;
+    const unsigned shift = bit % 32;
+    packed[bit / 32] |= values[i] << shift;
+    if (shift + bits > 32) {
+      packed[bit / 32 + 1] |= values[i] >> (32 - shift);
+    }
+  }
+}
+
+void UnpackRow(const uint32_t *packed, size_t count, unsigned bits,
+               size_t first_bit, uint32_t *values) {
+  if (bits == 0) {
+    std::fill(values, values + count, 0);
+    return;
+  }
+  const uint32_t mask = bits == 32 ? UINT32_MAX : (1u << bits) - 1;
+  for (size_t i = 0; i < count; ++i) {
+    const size_t bit = first_bit + i * bits;
+    const unsigned shift = bit % 32;
+    uint32_t value = packed[bit / 32] >> shift;
+    if (shift + bits > 32) {
+      value |= packed[bit / 32 + 1] << (32 - shift);
+    }
+    values[i] = value & mask;
+  }
+}
+
+// Rounds the TF up to 255ths, so the bound is never below it
+uint32_t QuantizeTermFreq(double term_freq) {
+  return std::min(static_cast<uint32_t>(term_freq * 255) + 1, 255u);
+}
+
+} // namespace
+
+void CompressedPostings::Encode(const std::vector<int> &ordinals,
+                                const std::vector<uint32_t> &counts,
+                                const std::vector<double> &term_freqs,
+                                std::vector<uint32_t> &data) {
+  uint32_t deltas[BLOCK_SIZE];
+  uint32_t extra_counts[BLOCK_SIZE];
+  for (size_t first = 0; first < ordinals.size(); first += BLOCK_SIZE) {
+    const size_t block_size = std::min<size_t>(ordinals.size() - first,
+                                               CompressedPostings::BLOCK_SIZE);
+    uint32_t max_delta = 0;
+    uint32_t max_count = 0;
+    uint32_t max_term_freq = 0;
+    for (size_t i = 0; i < block_size; ++i) {
+      max_term_freq =
+          std::max(max_term_freq, QuantizeTermFreq(term_freqs[first + i]));
+      deltas[i] = i == 0 ? 0
+                         : static_cast<uint32_t>(ordinals[first + i] -
+                                                 ordinals[first + i - 1] - 1);
+      extra_counts[i] = counts[first + i] - 1;
+      max_delta = std::max(max_delta, deltas[i]);
+      max_count = std::max(max_count, extra_counts[i]);
+    }
+    const unsigned delta_bits = GetBitWidth(max_delta);
+    const unsigned count_bits = GetBitWidth(max_count);
+    data.push_back(static_cast<uint32_t>(ordinals[first]));
+    data.push_back(static_cast<uint32_t>(ordinals[first + block_size - 1]));
+    data.push_back(static_cast<uint32_t>(block_size) | delta_bits << 8 |
+                   count_bits << 16 | max_term_freq << 24);
+    const size_t offset = data.size();
+    data.resize(offset + (block_size * (delta_bits + count_bits) + 31) / 32);
+    uint32_t *packed = data.data() + offset;
+    if (block_size == BLOCK_SIZE) {
+      PackLanes(deltas, delta_bits, packed);
+      PackLanes(extra_counts, count_bits, packed + 4 * delta_bits);
+    } else {
+      PackRow(deltas, block_size, delta_bits, 0, packed);
+      PackRow(extra_counts, block_size, count_bits, block_size * delta_bits,
+              packed);
+    }
+  }
+}
+
+bool CompressedPostings::Validate(const uint32_t *data, size_t word_count,
+                                  size_t posting_count, int first_ordinal,
+                                  int last_ordinal) {
+  int ordinals[BLOCK_SIZE];
+  uint32_t counts[BLOCK_SIZE];
+  size_t words = 0;
+  int64_t previous_ordinal = static_cast<int64_t>(first_ordinal) - 1;
+  for (size_t remaining = posting_count; remaining > 0;) {
+    if (word_count - words < HEADER_WORDS) {
+      return false;
+    }
+    const uint32_t *block = data + words;
+    const size_t block_size = GetBlockSize(block);
+    const unsigned delta_bits = block[2] >> 8 & 0xff;
+    const unsigned count_bits = block[2] >> 16 & 0xff;
+    if (block_size == 0 || block_size > remaining || delta_bits > 32 ||
+        count_bits > 32 ||
+        (block_size < BLOCK_SIZE && block_size != remaining) ||
+        GetBlockWords(block) > word_count - words ||
+        block[0] > block[1] || block[0] <= previous_ordinal ||
+        block[1] >= static_cast<uint64_t>(last_ordinal)) {
+      return false;
+    }
+    // Gaps decoded from the block must land exactly on its last ordinal
+    DecodeBlock(block, ordinals, counts);
+    for (size_t i = 1; i < block_size; ++i) {
+      if (ordinals[i] <= ordinals[i - 1]) {
+        return false;
+      }
+    }
+    if (ordinals[block_size - 1] != static_cast<int>(block[1])) {
+      return false;
+    }
+    previous_ordinal = block[1];
+    remaining -= block_size;
+    words += GetBlockWords(block);
+  }
+  return true;
+}
+
+double CompressedPostings::GetMaxTermFreq() const {
+  double max_term_freq = 0;
+  const uint32_t *block = data_;
+  for (size_t remaining = size_; remaining > 0;) {
+    max_term_freq = std::max(max_term_freq, GetBlockMaxTermFreq(block));
+    remaining -= GetBlockSize(block);
+    block += GetBlockWords(block);
+  }
+  return max_term_freq;
+}
+
+CompressedPostings::Cursor::Cursor(const CompressedPostings &postings)
+    : block_(postings.data_), remaining_(postings.size_) {}
+
+void CompressedPostings::Cursor::SkipTo(int ordinal) {
+  SkipBlocksTo(ordinal);
+  if (remaining_ == 0 || static_cast<int>(block_[0]) >= ordinal) {
+    return;
+  }
+  // The posting is inside this block, its last ordinal bounds the scan
+  if (!decoded_) {
+    DecodeBlock(block_, ordinals_, counts_);
+    decoded_ = true;
+  }
+  while (ordinals_[position_] < ordinal) {
+    ++position_;
+  }
+}
+
+void CompressedPostings::Cursor::SkipBlocksTo(int ordinal) {
+  while (remaining_ > 0 && static_cast<int>(block_[1]) < ordinal) {
+    remaining_ -= GetBlockSize(block_);
+    block_ += GetBlockWords(block_);
+    position_ = 0;
+    decoded_ = false;
+  }
+}
+
+void CompressedPostings::DecodeBlock(const uint32_t *block, int *ordinals,
+                                     uint32_t *counts) {
+  const size_t block_size = GetBlockSize(block);
+  const unsigned delta_bits = block[2] >> 8 & 0xff;
+  const unsigned count_bits = block[2] >> 16 & 0xff;
+  const uint32_t *packed = block + HEADER_WORDS;
+  uint32_t deltas[BLOCK_SIZE];
+  if (block_size == BLOCK_SIZE) {
+    UNPACK_KERNELS[delta_bits](packed, deltas);
+    UNPACK_KERNELS[count_bits](packed + 4 * delta_bits, counts);
+  } else {
+    UnpackRow(packed, block_size, delta_bits, 0, deltas);
+    UnpackRow(packed, block_size, count_bits, block_size * delta_bits,
+              counts);
+  }
+  // Unsigned sums wrap instead of overflowing on corrupted gaps
+  uint32_t ordinal = block[0];
+  ordinals[0] = static_cast<int>(ordinal);
+  for (size_t i = 1; i < block_size; ++i) {
+    ordinal += deltas[i] + 1;
+    ordinals[i] = static_cast<int>(ordinal);
+  }
+  for (size_t i = 0; i < block_size; ++i) {
+    ++counts[i];
+  }
+}
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Read-only view of the postings of one word packed into blocks of up to
+// BLOCK_SIZE postings. A block is a header of three words, the ordinals of
+// its first and last postings and the number of postings with the bit
+// widths of its values and an upper bound of its TFs in 255ths, followed
+// by the gaps between successive ordinals
+// and the occurrence counts, both minus one and bit-packed with the widths
+// of the largest value of the block. Full blocks pack every value into one
+// of four interleaved lanes, so unpacking runs four values per instruction
+// wherever the compiler vectorises it. The data is plain 32-bit words, a
+// mapped snapshot is used in place.
+class CompressedPostings {
+public:
+  static constexpr size_t BLOCK_SIZE = 128;
+
+  class Cursor;
+
+  CompressedPostings() = default;
+  CompressedPostings(const uint32_t *data, size_t posting_count);
+
+  size_t size() const;
+  bool empty() const;
+
+  // Calls func(ordinal, count) for postings with ordinals in
+  // [first_ordinal, last_ordinal) in increasing order. Blocks outside the
+  // range are skipped by their headers without unpacking
+  template <typename Func>
+  void ForEach(int first_ordinal, int last_ordinal, Func func) const;
+  // Calls func(last_ordinal, posting_count) for every block
+  template <typename Func> void ForEachBlock(Func func) const;
+  // Largest TF bound of the blocks, from their headers
+  double GetMaxTermFreq() const;
+
+  // Appends the packed postings to data. Ordinals must be increasing,
+  // counts positive, the TFs in (0, 1] are only kept as block bounds
+  static void Encode(const std::vector<int> &ordinals,
+                     const std::vector<uint32_t> &counts,
+                     const std::vector<double> &term_freqs,
+                     std::vector<uint32_t> &data);
+  // Checks that posting_count postings with ordinals in
+  // [first_ordinal, last_ordinal) are packed within the first word_count
+  // words of data, so a mapped snapshot can't make decoding read past it
+  static bool Validate(const uint32_t *data, size_t word_count,
+                       size_t posting_count, int first_ordinal,
+                       int last_ordinal);
+
+private:
+  friend class Cursor;
+
+  static constexpr size_t HEADER_WORDS = 3;
+
+  const uint32_t *data_ = nullptr;
+  size_t size_ = 0;
+
+  static size_t GetBlockSize(const uint32_t *block);
+  // Not less than the TF of any posting of the block
+  static double GetBlockMaxTermFreq(const uint32_t *block);
+  // Words taken by a block of the given header
+  static size_t GetBlockWords(const uint32_t *block);
+  static void DecodeBlock(const uint32_t *block, int *ordinals,
+                          uint32_t *counts);
+};
+
+// Forward-only position in the postings for intersecting lists. SkipTo
+// steps over whole blocks by their headers and unpacks only the block it
+// stops in
+class CompressedPostings::Cursor {
+public:
+  // GetOrdinal() of an exhausted cursor
+  static constexpr int END = INT_MAX;
+
+  explicit Cursor(const CompressedPostings &postings);
+
+  int GetOrdinal() const;
+  // Count of the current posting, unpacks its block
+  uint32_t GetCount();
+  // Moves to the first posting with ordinal not less than the given one
+  void SkipTo(int ordinal);
+  void Next();
+  // Moves to the first block with a posting not less than the ordinal
+  // without unpacking anything
+  void SkipBlocksTo(int ordinal);
+  // Last ordinal and TF bound of the current block, END and 0 once the
+  // cursor is exhausted
+  int GetBlockLastOrdinal() const;
+  double GetBlockMaxTermFreq() const;
+
+private:
+  const uint32_t *block_;
+  // Postings in the blocks from block_ on
+  size_t remaining_;
+  size_t position_ = 0;
+  // Ordinals of block_, unpacked once the cursor stops in it
+  int ordinals_[BLOCK_SIZE];
+  uint32_t counts_[BLOCK_SIZE];
+  bool decoded_ = false;
+};
+
+inline CompressedPostings::CompressedPostings(const uint32_t *data,
+                                              size_t posting_count)
+    : data_(data), size_(posting_count) {}
+
+inline size_t CompressedPostings::size() const { return size_; }
+
+inline bool CompressedPostings::empty() const { return size_ == 0; }
+
+inline size_t CompressedPostings::GetBlockSize(const uint32_t *block) {
+  return block[2] & 0xff;
+}
+
+inline double CompressedPostings::GetBlockMaxTermFreq(const uint32_t *block) {
+  return (block[2] >> 24) / 255.0;
+}
+
+inline size_t CompressedPostings::GetBlockWords(const uint32_t *block) {
+  const size_t block_size = GetBlockSize(block);
+  const size_t bits = (block[2] >> 8 & 0xff) + (block[2] >> 16 & 0xff);
+  return HEADER_WORDS + (block_size * bits + 31) / 32;
+}
+
+template <typename Func>
+void CompressedPostings::ForEach(int first_ordinal, int last_ordinal,
+                                 Func func) const {
+  int ordinals[BLOCK_SIZE];
+  uint32_t counts[BLOCK_SIZE];
+  const uint32_t *block = data_;
+  for (size_t remaining = size_; remaining > 0;) {
+    if (static_cast<int>(block[0]) >= last_ordinal) {
+      return;
+    }
+    const size_t block_size = GetBlockSize(block);
+    if (static_cast<int>(block[1]) >= first_ordinal) {
+      DecodeBlock(block, ordinals, counts);
+      size_t first = 0;
+      size_t last = block_size;
+      // Only the blocks at the ends of the range need trimming
+      while (ordinals[first] < first_ordinal) {
+        ++first;
+      }
+      while (ordinals[last - 1] >= last_ordinal) {
+        --last;
+      }
+      for (size_t i = first; i < last; ++i) {
+        func(ordinals[i], counts[i]);
+      }
+    }
+    remaining -= block_size;
+    block += GetBlockWords(block);
+  }
+}
+
+inline int CompressedPostings::Cursor::GetOrdinal() const {
+  if (remaining_ == 0) {
+    return END;
+  }
+  return decoded_ ? ordinals_[position_] : static_cast<int>(block_[0]);
+}
+
+inline uint32_t CompressedPostings::Cursor::GetCount() {
+  if (!decoded_) {
+    DecodeBlock(block_, ordinals_, counts_);
+    decoded_ = true;
+  }
+  return counts_[position_];
+}
+
+inline void CompressedPostings::Cursor::Next() {
+  GetCount();
+  if (++position_ == GetBlockSize(block_)) {
+    remaining_ -= position_;
+    block_ += GetBlockWords(block_);
+    position_ = 0;
+    decoded_ = false;
+  }
+}
+
+inline int CompressedPostings::Cursor::GetBlockLastOrdinal() const {
+  return remaining_ > 0 ? static_cast<int>(block_[1]) : END;
+}
+
+inline double CompressedPostings::Cursor::GetBlockMaxTermFreq() const {
+  return remaining_ > 0 ? CompressedPostings::GetBlockMaxTermFreq(block_) : 0;
+}
+
+template <typename Func>
+void CompressedPostings::ForEachBlock(Func func) const {
+  const uint32_t *block = data_;
+  for (size_t remaining = size_; remaining > 0;) {
+    const size_t block_size = GetBlockSize(block);
+    func(static_cast<int>(block[1]), block_size);
+    remaining -= block_size;
+    block += GetBlockWords(block);
+  }
+}
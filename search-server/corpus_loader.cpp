@@ -0,0 +1,140 @@
+#include <charconv>
+#include <future>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+#include "corpus_loader.h"
+#include "mapped_file.h"
+
+namespace {
+
+// Position of a batch in the corpus, for the error messages
+struct CorpusPosition {
+  size_t offset = 0;
+  size_t line = 1;
+  int next_id = 0;
+};
+
+std::invalid_argument MakeRecordError(size_t line, const std::string &what) {
+  return std::invalid_argument("Malformed record on line " +
+                               std::to_string(line) + ": " + what + ".");
+}
+
+// Cuts the field up to the next tab off the record
+std::string_view TakeField(std::string_view &record, size_t line) {
+  const size_t tab = record.find('\t');
+  if (tab == record.npos) {
+    throw MakeRecordError(line, "too few fields");
+  }
+  const std::string_view field = record.substr(0, tab);
+  record.remove_prefix(tab + 1);
+  return field;
+}
+
+int ParseInt(std::string_view text, size_t line) {
+  int value = 0;
+  const auto [end, error] =
+      std::from_chars(text.data(), text.data() + text.size(), value);
+  if (error != std::errc() || end != text.data() + text.size()) {
+    throw MakeRecordError(line, "bad number '" + std::string(text) + "'");
+  }
+  return value;
+}
+
+DocumentStatus ParseStatus(std::string_view text, size_t line) {
+  if (text == "ACTUAL") {
+    return DocumentStatus::ACTUAL;
+  }
+  if (text == "IRRELEVANT") {
+    return DocumentStatus::IRRELEVANT;
+  }
+  if (text == "BANNED") {
+    return DocumentStatus::BANNED;
+  }
+  if (text == "REMOVED") {
+    return DocumentStatus::REMOVED;
+  }
+  throw MakeRecordError(line, "bad status '" + std::string(text) + "'");
+}
+
+NewDocument ParseRecord(std::string_view record, size_t line) {
+  NewDocument document;
+  document.id = ParseInt(TakeField(record, line), line);
+  document.status = ParseStatus(TakeField(record, line), line);
+  std::string_view ratings = TakeField(record, line);
+  while (!ratings.empty()) {
+    const size_t space = ratings.find(' ');
+    document.ratings.push_back(ParseInt(ratings.substr(0, space), line));
+    ratings.remove_prefix(space == ratings.npos ? ratings.size() : space + 1);
+  }
+  document.text = record;
+  return document;
+}
+
+// Parses whole lines from position on until the batch has at least
+// batch_bytes of text and a document or the corpus ends
+std::vector<NewDocument> ParseBatch(std::string_view corpus,
+                                    CorpusFormat format, size_t batch_bytes,
+                                    CorpusPosition &position) {
+  std::vector<NewDocument> batch;
+  const size_t batch_end = position.offset + batch_bytes;
+  while (position.offset < corpus.size() &&
+         (position.offset < batch_end || batch.empty())) {
+    size_t line_end = corpus.find('\n', position.offset);
+    if (line_end == corpus.npos) {
+      line_end = corpus.size();
+    }
+    const std::string_view line =
+        corpus.substr(position.offset, line_end - position.offset);
+    if (format == CorpusFormat::LINES) {
+      // Blank lines separate nothing and take no ids
+      if (!line.empty()) {
+        batch.push_back(
+            {position.next_id++, line, DocumentStatus::ACTUAL, {}});
+      }
+    } else {
+      batch.push_back(ParseRecord(line, position.line));
+    }
+    position.offset = line_end + 1;
+    ++position.line;
+  }
+  return batch;
+}
+
+} // namespace
+
+size_t AddDocumentsFromFile(SearchServer &search_server,
+                            const std::string &path, CorpusFormat format,
+                            int first_id, size_t batch_bytes) {
+  const MappedFile file(path);
+  file.AdviseSequential();
+  const std::string_view corpus(file.data(), file.size());
+  CorpusPosition position;
+  position.next_id = first_id;
+  size_t document_count = 0;
+  // Indexing of a batch runs while the next one is parsed, the future is
+  // waited for before the mapping goes away even if parsing throws
+  std::future<void> indexing;
+  while (position.offset < corpus.size()) {
+    std::vector<NewDocument> batch =
+        ParseBatch(corpus, format, batch_bytes, position);
+    // Only blank lines were left
+    if (batch.empty()) {
+      continue;
+    }
+    if (indexing.valid()) {
+      indexing.get();
+    }
+    document_count += batch.size();
+    indexing = std::async(std::launch::async,
+                          [&search_server, batch = std::move(batch)] {
+                            search_server.AddDocuments(std::execution::par,
+                                                       batch);
+                          });
+  }
+  if (indexing.valid()) {
+    indexing.get();
+  }
+  return document_count;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "search_server.h"
+
+// Layout of a corpus file, one document per line
+enum class CorpusFormat {
+  // The line is the text of an ACTUAL document without ratings, documents
+  // take consecutive ids. Empty lines are skipped and take no id
+  LINES,
+  // id<TAB>status<TAB>ratings<TAB>text, status is ACTUAL, IRRELEVANT,
+  // BANNED or REMOVED and ratings are separated by spaces
+  RECORDS,
+};
+
+// Indexes every document of the corpus file at path with parallel
+// AddDocuments, in batches of about batch_bytes of text and at least one
+// document. Every slice of a batch interns its own vocabulary, so small
+// batches cost more per document. The file is mapped and documents are
+// views of the mapping, text is never copied; the next batch is parsed,
+// which also pages it in, while the previous one is being indexed. LINES
+// documents get ids from first_id on. Returns the number of documents
+// added.
+// Throws std::runtime_error if the file can't be mapped and
+// std::invalid_argument on a malformed record or a document AddDocuments
+// rejects, the batches before it stay indexed
+size_t AddDocumentsFromFile(SearchServer &search_server,
+                            const std::string &path,
+                            CorpusFormat format = CorpusFormat::LINES,
+                            int first_id = 0,
+                            size_t batch_bytes = size_t{32} << 20);
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Contiguous array that either owns its elements or views elements owned by
+// someone else, such as a mapped snapshot file. Reading doesn't care which,
+// the first modification copies viewed elements into an owned vector.
+// T must be trivially copyable to be viewed in a mapped file.
+template <typename T> class CowArray {
+public:
+  CowArray() = default;
+  explicit CowArray(std::vector<T> elements) : owned_(std::move(elements)) {}
+
+  // The memory must outlive the array or its first modification
+  static CowArray View(const T *data, size_t size) {
+    CowArray array;
+    array.view_ = data;
+    array.view_size_ = size;
+    return array;
+  }
+
+  const T *begin() const { return view_ ? view_ : owned_.data(); }
+  const T *end() const { return begin() + size(); }
+  size_t size() const { return view_ ? view_size_ : owned_.size(); }
+  bool empty() const { return size() == 0; }
+  const T &operator[](size_t index) const { return begin()[index]; }
+  const T &back() const { return end()[-1]; }
+
+  // Owned elements, viewed ones are copied first
+  std::vector<T> &Mutable() {
+    if (view_) {
+      owned_.assign(view_, view_ + view_size_);
+      view_ = nullptr;
+      view_size_ = 0;
+    }
+    return owned_;
+  }
+
+  // Bytes allocated by the array, viewed memory isn't counted
+  size_t MemoryUsage() const { return owned_.capacity() * sizeof(T); }
+
+private:
+  std::vector<T> owned_;
+  const T *view_ = nullptr;
+  size_t view_size_ = 0;
+};
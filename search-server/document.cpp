@@ -1,8 +1,33 @@
+#include <cmath>
 #include <iostream>
 #include <string>
 
 #include "document.h"
 
+bool AlmostEqualRelative(double A, double B, double maxRelDiff) {
+  // Calculate the difference.
+  double diff = fabs(A - B);
+  A = fabs(A);
+  B = fabs(B);
+  // Find the largest
+  double largest = (B > A) ? B : A;
+
+  if (diff <= largest * maxRelDiff) {
+    return true;
+  }
+  return false;
+}
+
+bool IsMoreRelevant(const Document &lhs, const Document &rhs) {
+  if (AlmostEqualRelative(lhs.relevance, rhs.relevance)) {
+    if (lhs.rating == rhs.rating) {
+      return lhs.id < rhs.id;
+    }
+    return lhs.rating > rhs.rating;
+  }
+  return lhs.relevance > rhs.relevance;
+}
+
 void PrintDocument(const Document &document) {
   std::cout << document << std::endl;
 }
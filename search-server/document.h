@@ -1,6 +1,9 @@
 #pragma once
 
+#include <float.h>
 #include <iostream>
+#include <string_view>
+#include <vector>
 
 struct Document {
   int id = 0;
@@ -21,6 +24,26 @@ enum class DocumentStatus {
   REMOVED,
 };
 
+// Arguments of one AddDocument call, for adding documents in bulk
+struct NewDocument {
+  int id = 0;
+  std::string_view text;
+  DocumentStatus status = DocumentStatus::ACTUAL;
+  std::vector<int> ratings;
+};
+
+// static const double DBL_EPSILON = 2.2e-016; //In the latter standarts this
+// variable is defined in the <cmath>
+
+// This function is used to check if two doubles are equal within a margine of
+// an _DBL_EPSILON = 2.2e-016
+bool AlmostEqualRelative(double A, double B, double maxRelDiff = DBL_EPSILON);
+
+// Ranking order of the search results: higher relevance first, documents of
+// almost equal relevance are ordered by rating, then by id, so the order of
+// the results doesn't depend on the order they were found in
+bool IsMoreRelevant(const Document &lhs, const Document &rhs);
+
 void PrintDocument(const Document &document);
 
 std::ostream &operator<<(std::ostream &os, const Document &document);
\ No newline at end of file
@@ -0,0 +1,86 @@
+#include <algorithm>
+
+#include "document_filter.h"
+
+DocumentFilter::DocumentFilter(DocumentStatus status)
+    : statuses(GetStatusBit(status)) {}
+
+bool DocumentFilter::Matches(int document_id, DocumentStatus status,
+                             int rating) const {
+  return (statuses & GetStatusBit(status)) != 0 && rating >= min_rating &&
+         rating <= max_rating && document_id >= min_document_id &&
+         document_id <= max_document_id;
+}
+
+bool DocumentFilter::operator==(const DocumentFilter &other) const {
+  return statuses == other.statuses && min_rating == other.min_rating &&
+         max_rating == other.max_rating &&
+         min_document_id == other.min_document_id &&
+         max_document_id == other.max_document_id;
+}
+
+void FilterColumns::Add(int document_id, DocumentStatus status, int rating) {
+  const size_t ordinal = ratings_.size();
+  if (ordinal % 64 == 0) {
+    for (std::vector<uint64_t> &bitmap : status_bitmaps_) {
+      bitmap.push_back(0);
+    }
+  }
+  status_bitmaps_[static_cast<size_t>(status)][ordinal >> 6] |=
+      uint64_t{1} << (ordinal & 63);
+  statuses_.push_back(status);
+  ratings_.push_back(rating);
+  document_ids_.push_back(document_id);
+}
+
+void FilterColumns::Remove(int ordinal) {
+  status_bitmaps_[static_cast<size_t>(statuses_[ordinal])][ordinal >> 6] &=
+      ~(uint64_t{1} << (ordinal & 63));
+}
+
+void FilterColumns::Clear() {
+  for (std::vector<uint64_t> &bitmap : status_bitmaps_) {
+    bitmap.clear();
+  }
+  statuses_.clear();
+  ratings_.clear();
+  document_ids_.clear();
+}
+
+FilterMask::FilterMask(const FilterColumns &columns,
+                       const DocumentFilter &filter)
+    : columns_(&columns), filter_(filter),
+      has_ranges_(filter.min_rating != INT_MIN ||
+                  filter.max_rating != INT_MAX ||
+                  filter.min_document_id != INT_MIN ||
+                  filter.max_document_id != INT_MAX) {
+  // Bits of no status would index past the bitmaps, a filter of none of
+  // the statuses matches nothing
+  filter_.statuses &= (1u << FilterColumns::STATUS_COUNT) - 1;
+}
+
+void FilterMask::Reset(int first_ordinal, int last_ordinal) {
+  first_word_ = static_cast<size_t>(first_ordinal) >> 6;
+  const size_t word_count =
+      last_ordinal > first_ordinal
+          ? ((static_cast<size_t>(last_ordinal) - 1) >> 6) - first_word_ + 1
+          : 0;
+  const uint32_t statuses = filter_.statuses;
+  // A single status needs no merging
+  if (statuses != 0 && (statuses & (statuses - 1)) == 0) {
+    const size_t status = __builtin_ctz(statuses);
+    status_bits_ = columns_->status_bitmaps_[status].data() + first_word_;
+    return;
+  }
+  merged_bits_.assign(word_count, 0);
+  for (size_t status = 0; status < FilterColumns::STATUS_COUNT; ++status) {
+    if (statuses >> status & 1) {
+      const uint64_t *bitmap =
+          columns_->status_bitmaps_[status].data() + first_word_;
+      for (size_t i = 0; i < word_count; ++i) {
+        merged_bits_[i] |= bitmap[i];
+      }
+    }
+  }
+  status_bits_ = merged_bits_.data();
+}
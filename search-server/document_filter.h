@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "document.h"
+
+// Declarative filter of FindTopDocuments: a set of statuses and inclusive
+// ranges of ratings and document ids. Unlike a predicate it is evaluated
+// against bitmaps of the statuses and columns of the ratings and ids the
+// server keeps by ordinal
+struct DocumentFilter {
+  // GetStatusBit of every allowed status
+  uint32_t statuses = GetStatusBit(DocumentStatus::ACTUAL);
+  int min_rating = INT_MIN;
+  int max_rating = INT_MAX;
+  int min_document_id = INT_MIN;
+  int max_document_id = INT_MAX;
+
+  // Actual documents of any rating and id
+  DocumentFilter() = default;
+  explicit DocumentFilter(DocumentStatus status);
+
+  static constexpr uint32_t GetStatusBit(DocumentStatus status) {
+    return 1u << static_cast<int>(status);
+  }
+  // The same check one document at a time
+  bool Matches(int document_id, DocumentStatus status, int rating) const;
+
+  bool operator==(const DocumentFilter &other) const;
+};
+
+// Per-document columns filters are evaluated against, index - ordinal.
+// Every status has a bitmap of its live documents, removed documents are
+// in none of them
+class FilterColumns {
+public:
+  static const size_t STATUS_COUNT =
+      static_cast<size_t>(DocumentStatus::REMOVED) + 1;
+
+  // Appends the document with the next ordinal
+  void Add(int document_id, DocumentStatus status, int rating);
+  void Remove(int ordinal);
+  void Clear();
+
+private:
+  friend class FilterMask;
+
+  std::array<std::vector<uint64_t>, STATUS_COUNT> status_bitmaps_;
+  std::vector<DocumentStatus> statuses_;
+  std::vector<int> ratings_;
+  std::vector<int> document_ids_;
+};
+
+// Documents of an ordinal range a filter lets through. A filter of one
+// status tests the bitmap of the status in place, bitmaps of several
+// statuses are merged for the range 64 documents at a time. Ratings and
+// ids are compared only for documents of the allowed statuses
+class FilterMask {
+public:
+  // The columns must outlive the mask and not change while it is used
+  FilterMask(const FilterColumns &columns, const DocumentFilter &filter);
+
+  // Prepares the bits of ordinals [first_ordinal, last_ordinal)
+  void Reset(int first_ordinal, int last_ordinal);
+  bool operator()(int ordinal) const;
+
+private:
+  const FilterColumns *columns_;
+  DocumentFilter filter_;
+  bool has_ranges_;
+  size_t first_word_ = 0;
+  // Bits of the allowed statuses from the word of the first ordinal
+  const uint64_t *status_bits_ = nullptr;
+  // Merged bitmaps of the allowed statuses, index - word from first_word_
+  std::vector<uint64_t> merged_bits_;
+};
+
+inline bool FilterMask::operator()(int ordinal) const {
+  const size_t index = (static_cast<size_t>(ordinal) >> 6) - first_word_;
+  if (!(status_bits_[index] >> (ordinal & 63) & 1)) {
+    return false;
+  }
+  if (!has_ranges_) {
+    return true;
+  }
+  const int rating = columns_->ratings_[ordinal];
+  const int document_id = columns_->document_ids_[ordinal];
+  return rating >= filter_.min_rating && rating <= filter_.max_rating &&
+         document_id >= filter_.min_document_id &&
+         document_id <= filter_.max_document_id;
+}
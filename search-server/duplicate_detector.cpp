@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <array>
+#include <execution>
+#include <numeric>
+#include <utility>
+
+#include "duplicate_detector.h"
+
+namespace {
+
+// MinHash signature is MINHASH_BANDS bands of MINHASH_ROWS hashes, documents
+// having an equal band become candidates. A pair with similarity s shares a
+// band with probability 1 - (1 - s^ROWS)^BANDS: 0.99 for 0.7, 0.89 for 0.6
+const size_t MINHASH_BANDS = 16;
+const size_t MINHASH_ROWS = 4;
+using Signature = std::array<uint64_t, MINHASH_BANDS * MINHASH_ROWS>;
+
+// splitmix64 finalizer, spreads the bits of the value over the whole hash
+uint64_t MixHash(uint64_t value) {
+  value += 0x9e3779b97f4a7c15;
+  value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9;
+  value = (value ^ (value >> 27)) * 0x94d049bb133111eb;
+  return value ^ (value >> 31);
+}
+
+// Terms are sorted, so equal sets give equal hashes
+uint64_t HashTerms(const std::vector<TermId> &terms) {
+  uint64_t hash = MixHash(terms.size());
+  for (const TermId term : terms) {
+    hash = MixHash(hash ^ term);
+  }
+  return hash;
+}
+
+Signature ComputeSignature(const std::vector<TermId> &terms) {
+  Signature signature;
+  signature.fill(UINT64_MAX);
+  for (const TermId term : terms) {
+    for (size_t i = 0; i < signature.size(); ++i) {
+      // Every slot hashes the term with its own function
+      signature[i] =
+          std::min(signature[i], MixHash(uint64_t{term} << 32 | i));
+    }
+  }
+  return signature;
+}
+
+// Sets is_duplicate[i] for documents whose terms equal terms of a document
+// with smaller index
+void MarkExactDuplicates(const std::vector<std::vector<TermId>> &terms,
+                         std::vector<char> &is_duplicate) {
+  std::vector<uint64_t> hashes(terms.size());
+  std::transform(std::execution::par, terms.begin(), terms.end(),
+                 hashes.begin(), HashTerms);
+  std::vector<size_t> order(terms.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(std::execution::par, order.begin(), order.end(),
+            [&hashes](size_t lhs, size_t rhs) {
+              return std::pair(hashes[lhs], lhs) < std::pair(hashes[rhs], rhs);
+            });
+
+  // Group i is order[group_starts[i], group_starts[i + 1])
+  std::vector<size_t> group_starts;
+  for (size_t i = 0; i < order.size(); ++i) {
+    if (i == 0 || hashes[order[i]] != hashes[order[i - 1]]) {
+      group_starts.push_back(i);
+    }
+  }
+  group_starts.push_back(order.size());
+
+  std::vector<size_t> groups(group_starts.size() - 1);
+  std::iota(groups.begin(), groups.end(), 0);
+  std::for_each(std::execution::par, groups.begin(), groups.end(),
+                [&](size_t group) {
+                  // Distinct sets of the group, more than one only on a hash
+                  // collision
+                  std::vector<size_t> originals;
+                  for (size_t i = group_starts[group];
+                       i < group_starts[group + 1]; ++i) {
+                    const size_t document = order[i];
+                    const bool repeats = std::any_of(
+                        originals.begin(), originals.end(),
+                        [&](size_t original) {
+                          return terms[original] == terms[document];
+                        });
+                    if (repeats) {
+                      is_duplicate[document] = true;
+                    } else {
+                      originals.push_back(document);
+                    }
+                  }
+                });
+}
+
+// Sets is_duplicate[i] for documents similar to a kept document with
+// smaller index, documents marked already are skipped
+void MarkNearDuplicates(const std::vector<std::vector<TermId>> &terms,
+                        double similarity_threshold,
+                        std::vector<char> &is_duplicate) {
+  std::vector<size_t> documents;
+  for (size_t i = 0; i < terms.size(); ++i) {
+    if (!is_duplicate[i]) {
+      documents.push_back(i);
+    }
+  }
+  std::vector<Signature> signatures(documents.size());
+  std::transform(std::execution::par, documents.begin(), documents.end(),
+                 signatures.begin(),
+                 [&terms](size_t document) {
+                   return ComputeSignature(terms[document]);
+                 });
+
+  // (hash of the band, position in documents) for every band of every
+  // document, equal hashes go together after sorting
+  std::vector<std::pair<uint64_t, size_t>> band_keys;
+  band_keys.reserve(documents.size() * MINHASH_BANDS);
+  for (size_t position = 0; position < documents.size(); ++position) {
+    for (size_t band = 0; band < MINHASH_BANDS; ++band) {
+      uint64_t hash = MixHash(band);
+      for (size_t row = 0; row < MINHASH_ROWS; ++row) {
+        hash = MixHash(hash ^
+                       signatures[position][band * MINHASH_ROWS + row]);
+      }
+      band_keys.emplace_back(hash, position);
+    }
+  }
+  std::sort(std::execution::par, band_keys.begin(), band_keys.end());
+
+  // Candidate pairs (later, earlier) by position in documents
+  std::vector<std::pair<size_t, size_t>> candidates;
+  for (size_t start = 0; start < band_keys.size();) {
+    size_t end = start + 1;
+    while (end < band_keys.size() &&
+           band_keys[end].first == band_keys[start].first) {
+      ++end;
+    }
+    for (size_t later = start + 1; later < end; ++later) {
+      for (size_t earlier = start; earlier < later; ++earlier) {
+        // Bands of one document may collide too
+        if (band_keys[earlier].second != band_keys[later].second) {
+          candidates.emplace_back(band_keys[later].second,
+                                  band_keys[earlier].second);
+        }
+      }
+    }
+    start = end;
+  }
+  std::sort(std::execution::par, candidates.begin(), candidates.end());
+  candidates.erase(std::unique(candidates.begin(), candidates.end()),
+                   candidates.end());
+
+  std::vector<char> is_similar(candidates.size());
+  std::transform(std::execution::par, candidates.begin(), candidates.end(),
+                 is_similar.begin(),
+                 [&](const std::pair<size_t, size_t> &candidate) {
+                   return ComputeJaccardSimilarity(
+                              terms[documents[candidate.first]],
+                              terms[documents[candidate.second]]) >=
+                          similarity_threshold;
+                 });
+
+  // Pairs are sorted by the later document, so whether the earlier one is
+  // kept is already known
+  for (size_t i = 0; i < candidates.size(); ++i) {
+    const size_t later = documents[candidates[i].first];
+    const size_t earlier = documents[candidates[i].second];
+    if (is_similar[i] && !is_duplicate[earlier]) {
+      is_duplicate[later] = true;
+    }
+  }
+}
+
+} // namespace
+
+std::vector<int> FindDuplicates(const SearchServer &search_server,
+                                double similarity_threshold) {
+  const std::vector<int> ids = search_server.GetDocumentIds();
+  std::vector<std::vector<TermId>> terms(ids.size());
+  std::transform(std::execution::par, ids.begin(), ids.end(), terms.begin(),
+                 [&search_server](int document_id) {
+                   return search_server.GetDocumentTerms(document_id);
+                 });
+
+  std::vector<char> is_duplicate(ids.size());
+  MarkExactDuplicates(terms, is_duplicate);
+  if (similarity_threshold < 1.0) {
+    MarkNearDuplicates(terms, similarity_threshold, is_duplicate);
+  }
+
+  std::vector<int> duplicates;
+  for (size_t i = 0; i < ids.size(); ++i) {
+    if (is_duplicate[i]) {
+      duplicates.push_back(ids[i]);
+    }
+  }
+  return duplicates;
+}
+
+double ComputeJaccardSimilarity(const std::vector<TermId> &lhs,
+                                const std::vector<TermId> &rhs) {
+  if (lhs.empty() && rhs.empty()) {
+    return 1.0;
+  }
+  size_t common = 0;
+  for (auto lhs_it = lhs.begin(), rhs_it = rhs.begin();
+       lhs_it != lhs.end() && rhs_it != rhs.end();) {
+    if (*lhs_it < *rhs_it) {
+      ++lhs_it;
+    } else if (*rhs_it < *lhs_it) {
+      ++rhs_it;
+    } else {
+      ++common;
+      ++lhs_it;
+      ++rhs_it;
+    }
+  }
+  return static_cast<double>(common) / (lhs.size() + rhs.size() - common);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "search_server.h"
+
+// Ids of the documents repeating the set of words of a document with a
+// smaller id, sorted. Word sets are hashed in parallel and grouped by the
+// hash, documents of a group are compared exactly, so hash collisions never
+// make false duplicates.
+// With similarity_threshold below 1 a document is also a duplicate of a
+// kept document with smaller id when Jaccard similarity of their word sets
+// is at least the threshold. Candidates are found through MinHash
+// signatures split into bands (LSH), which reliably finds pairs similar by
+// 0.7 and more, and are checked against the exact similarity
+std::vector<int> FindDuplicates(const SearchServer &search_server,
+                                double similarity_threshold = 1.0);
+
+// Jaccard similarity of two sorted sets of terms
+double ComputeJaccardSimilarity(const std::vector<TermId> &lhs,
+                                const std::vector<TermId> &rhs);
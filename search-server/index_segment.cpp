@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <utility>
+
+#include "index_segment.h"
+
+void IndexSegment::Builder::Add(TermId term, int ordinal, uint32_t count,
+                                double term_freq) {
+  if (terms_.empty() || terms_.back().term != term) {
+    CompressLastTerm();
+    terms_.push_back({term, 0, data_.size(), 0});
+  }
+  ++terms_.back().posting_count;
+  ordinals_.push_back(ordinal);
+  counts_.push_back(count);
+  term_freqs_.push_back(term_freq);
+}
+
+IndexSegment
+IndexSegment::Builder::Build(int first_ordinal, int last_ordinal,
+                             std::vector<double> inverse_word_counts) {
+  CompressLastTerm();
+  terms_.shrink_to_fit();
+  data_.shrink_to_fit();
+  return IndexSegment(first_ordinal, last_ordinal,
+                      CowArray<SegmentTerm>(std::move(terms_)),
+                      CowArray<uint32_t>(std::move(data_)),
+                      CowArray<double>(std::move(inverse_word_counts)));
+}
+
+void IndexSegment::Builder::CompressLastTerm() {
+  if (terms_.empty()) {
+    return;
+  }
+  SegmentTerm &term = terms_.back();
+  CompressedPostings::Encode(ordinals_, counts_, term_freqs_, data_);
+  term.max_term_freq =
+      CompressedPostings(data_.data() + term.first_word, term.posting_count)
+          .GetMaxTermFreq();
+  ordinals_.clear();
+  counts_.clear();
+  term_freqs_.clear();
+}
+
+IndexSegment::IndexSegment(int first_ordinal, int last_ordinal,
+                           CowArray<SegmentTerm> terms,
+                           CowArray<uint32_t> data,
+                           CowArray<double> inverse_word_counts,
+                           std::shared_ptr<const MappedFile> file)
+    : first_ordinal_(first_ordinal), last_ordinal_(last_ordinal),
+      terms_(std::move(terms)), data_(std::move(data)),
+      inverse_word_counts_(std::move(inverse_word_counts)),
+      file_(std::move(file)) {
+  for (const SegmentTerm &term : terms_) {
+    posting_count_ += term.posting_count;
+  }
+}
+
+IndexSegment IndexSegment::Merge(
+    const std::vector<std::shared_ptr<const IndexSegment>> &segments,
+    const std::vector<bool> &removed) {
+  const int first_ordinal = segments.front()->GetFirstOrdinal();
+  // Directory entries of all segments by term, segments of a term in
+  // ordinal order, so the merged postings come out sorted
+  std::vector<std::pair<size_t, const SegmentTerm *>> entries;
+  std::vector<double> inverse_word_counts;
+  for (size_t i = 0; i < segments.size(); ++i) {
+    for (const SegmentTerm &term : segments[i]->GetTerms()) {
+      entries.emplace_back(i, &term);
+    }
+    inverse_word_counts.insert(inverse_word_counts.end(),
+                               segments[i]->inverse_word_counts_.begin(),
+                               segments[i]->inverse_word_counts_.end());
+  }
+  std::stable_sort(entries.begin(), entries.end(),
+                   [](const auto &lhs, const auto &rhs) {
+                     return lhs.second->term < rhs.second->term;
+                   });
+
+  // Counts are copied as they are, the postings are only repacked
+  Builder builder;
+  for (const auto &[i, term] : entries) {
+    const IndexSegment &segment = *segments[i];
+    segment.ForEachCount(*term, [&](int ordinal, uint32_t count) {
+      if (!removed[ordinal - first_ordinal]) {
+        const double inverse_word_count =
+            segment.inverse_word_counts_[ordinal - segment.first_ordinal_];
+        builder.Add(term->term, ordinal, count, count * inverse_word_count);
+      }
+    });
+  }
+  return builder.Build(first_ordinal, segments.back()->GetLastOrdinal(),
+                       std::move(inverse_word_counts));
+}
+
+int IndexSegment::GetFirstOrdinal() const { return first_ordinal_; }
+
+int IndexSegment::GetLastOrdinal() const { return last_ordinal_; }
+
+PostingRange IndexSegment::Find(TermId term) const {
+  const auto it = std::lower_bound(terms_.begin(), terms_.end(), term,
+                                   [](const SegmentTerm &entry, TermId value) {
+                                     return entry.term < value;
+                                   });
+  if (it == terms_.end() || it->term != term) {
+    return {};
+  }
+  return GetPostings(*it);
+}
+
+const CowArray<SegmentTerm> &IndexSegment::GetTerms() const { return terms_; }
+
+const CowArray<uint32_t> &IndexSegment::GetData() const { return data_; }
+
+PostingRange IndexSegment::GetPostings(const SegmentTerm &term) const {
+  return {GetCompressed(term), inverse_word_counts_.begin(), first_ordinal_,
+          term.max_term_freq};
+}
+
+size_t IndexSegment::GetPostingCount() const { return posting_count_; }
+
+size_t IndexSegment::MemoryUsage() const {
+  return terms_.MemoryUsage() + data_.MemoryUsage() +
+         inverse_word_counts_.MemoryUsage();
+}
+
+CompressedPostings IndexSegment::GetCompressed(const SegmentTerm &term) const {
+  return {data_.begin() + term.first_word, term.posting_count};
+}
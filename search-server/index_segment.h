@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "compressed_postings.h"
+#include "cow_array.h"
+#include "mapped_file.h"
+#include "posting_list.h"
+#include "term_dictionary.h"
+
+// Directory entry of a segment: posting_count postings of the term are
+// compressed from data[first_word] on, none has TF above max_term_freq
+struct SegmentTerm {
+  TermId term;
+  uint32_t posting_count;
+  uint64_t first_word;
+  double max_term_freq;
+};
+
+// Immutable part of the inverted index with the postings of documents whose
+// ordinals are in [first_ordinal, last_ordinal). The directory is sorted by
+// term and the compressed postings of all terms lie in one array, so a
+// segment is three allocations however many words it has. Postings keep
+// occurrence counts, TFs come from them and the inverse word counts of the
+// documents the segment stores. The arrays may view a mapped file, the
+// segment keeps the mapping alive. Removed documents are not erased from a
+// segment, merging segments drops them.
+class IndexSegment {
+public:
+  // Collects postings term by term, terms must come in increasing order and
+  // postings of a term in increasing ordinal order
+  class Builder {
+  public:
+    void Add(TermId term, int ordinal, uint32_t count, double term_freq);
+    // inverse_word_counts[i] is 1 / number of words of the document with
+    // ordinal first_ordinal + i
+    IndexSegment Build(int first_ordinal, int last_ordinal,
+                       std::vector<double> inverse_word_counts);
+
+  private:
+    std::vector<SegmentTerm> terms_;
+    std::vector<uint32_t> data_;
+    // Postings of the last term, compressed when the term changes
+    std::vector<int> ordinals_;
+    std::vector<uint32_t> counts_;
+    std::vector<double> term_freqs_;
+
+    void CompressLastTerm();
+  };
+
+  IndexSegment(int first_ordinal, int last_ordinal,
+               CowArray<SegmentTerm> terms, CowArray<uint32_t> data,
+               CowArray<double> inverse_word_counts,
+               std::shared_ptr<const MappedFile> file = nullptr);
+
+  // Merges adjacent segments given in ordinal order. removed[i] tells if
+  // the document with ordinal first_ordinal + i is removed, its postings
+  // are dropped
+  static IndexSegment
+  Merge(const std::vector<std::shared_ptr<const IndexSegment>> &segments,
+        const std::vector<bool> &removed);
+
+  int GetFirstOrdinal() const;
+  int GetLastOrdinal() const;
+  // Postings of the term, empty if no document of the segment has it
+  PostingRange Find(TermId term) const;
+  const CowArray<SegmentTerm> &GetTerms() const;
+  // Compressed postings of all terms
+  const CowArray<uint32_t> &GetData() const;
+  PostingRange GetPostings(const SegmentTerm &term) const;
+  // Calls func(ordinal, count) for every posting of the directory entry
+  template <typename Func>
+  void ForEachCount(const SegmentTerm &term, Func func) const;
+  size_t GetPostingCount() const;
+  // Bytes allocated by the segment, mapped memory isn't counted
+  size_t MemoryUsage() const;
+
+private:
+  int first_ordinal_;
+  int last_ordinal_;
+  CowArray<SegmentTerm> terms_;
+  CowArray<uint32_t> data_;
+  // index - ordinal - first_ordinal_
+  CowArray<double> inverse_word_counts_;
+  size_t posting_count_ = 0;
+  std::shared_ptr<const MappedFile> file_;
+
+  CompressedPostings GetCompressed(const SegmentTerm &term) const;
+};
+
+template <typename Func>
+void IndexSegment::ForEachCount(const SegmentTerm &term, Func func) const {
+  GetCompressed(term).ForEach(first_ordinal_, last_ordinal_, func);
+}
@@ -1,4 +1,5 @@
 
+#include "benchmark_functions.h"
 #include "process_queries.h"
 #include "search_server.h"
 #include <execution>
@@ -6,7 +7,12 @@
 #include <string>
 #include <vector>
 using namespace std;
-int main() {
+int main(int argc, char *argv[]) {
+  if (argc > 1 && argv[1] == "--benchmark"s) {
+    RunBenchmarks();
+    return 0;
+  }
+
   SearchServer search_server("and with"s);
 
   int id = 0;
@@ -0,0 +1,47 @@
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mapped_file.h"
+
+MappedFile::MappedFile(const std::string &path) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Can't open file " + path);
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    close(fd);
+    throw std::runtime_error("Can't get size of file " + path);
+  }
+  size_ = static_cast<size_t>(file_stat.st_size);
+  if (size_ > 0) {
+    void *data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      close(fd);
+      throw std::runtime_error("Can't map file " + path);
+    }
+    data_ = static_cast<const char *>(data);
+  }
+  // The mapping stays valid without the descriptor
+  close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (data_) {
+    munmap(const_cast<char *>(data_), size_);
+  }
+}
+
+const char *MappedFile::data() const { return data_; }
+
+size_t MappedFile::size() const { return size_; }
+
+void MappedFile::AdviseSequential() const {
+  // Only a hint, the file reads the same if the kernel ignores it
+  if (data_) {
+    madvise(const_cast<char *>(data_), size_, MADV_SEQUENTIAL);
+  }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file, unmapped on destruction
+class MappedFile {
+public:
+  // Throws std::runtime_error if the file can't be opened or mapped
+  explicit MappedFile(const std::string &path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  const char *data() const;
+  size_t size() const;
+
+  // Tells the kernel the file is going to be read once from start to end,
+  // so it reads ahead aggressively and drops pages behind the reader
+  void AdviseSequential() const;
+
+private:
+  const char *data_ = nullptr;
+  size_t size_ = 0;
+};
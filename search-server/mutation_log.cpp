@@ -0,0 +1,302 @@
+#include <array>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <unistd.h>
+
+#include "mutation_log.h"
+#include "search_server.h"
+
+namespace {
+
+// Record: payload size, CRC-32 of type and payload, type, payload
+const size_t RECORD_HEADER_SIZE = 9;
+const char ADD_DOCUMENT = 'A';
+const char REMOVE_DOCUMENTS = 'R';
+
+uint32_t ComputeCrc32(const char *data, size_t size) {
+  static const std::array<uint32_t, 256> table = [] {
+    std::array<uint32_t, 256> result;
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t value = i;
+      for (int bit = 0; bit < 8; ++bit) {
+        value = (value & 1) ? 0xEDB88320 ^ (value >> 1) : value >> 1;
+      }
+      result[i] = value;
+    }
+    return result;
+  }();
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < size; ++i) {
+    const unsigned char byte = static_cast<unsigned char>(data[i]);
+    crc = table[(crc ^ byte) & 0xFF] ^ (crc >> 8);
+  }
+  return crc ^ 0xFFFFFFFF;
+}
+
+template <typename T> void AppendValue(std::string &out, T value) {
+  out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+// Reads values of a record payload, fails instead of reading past the end
+class PayloadReader {
+public:
+  explicit PayloadReader(std::string_view payload) : payload_(payload) {}
+
+  template <typename T> bool Read(T &value) {
+    if (payload_.size() < sizeof(value)) {
+      return false;
+    }
+    std::memcpy(&value, payload_.data(), sizeof(value));
+    payload_.remove_prefix(sizeof(value));
+    return true;
+  }
+
+  bool Read(std::string_view &text, size_t size) {
+    if (payload_.size() < size) {
+      return false;
+    }
+    text = payload_.substr(0, size);
+    payload_.remove_prefix(size);
+    return true;
+  }
+
+  bool AtEnd() const { return payload_.empty(); }
+
+private:
+  std::string_view payload_;
+};
+
+// Applies one record to the server, returns false if it is malformed
+bool ApplyRecord(char type, std::string_view payload,
+                 SearchServer &search_server) {
+  PayloadReader reader(payload);
+  if (type == ADD_DOCUMENT) {
+    int32_t document_id;
+    int32_t status;
+    uint32_t rating_count;
+    if (!reader.Read(document_id) || !reader.Read(status) || status < 0 ||
+        status > static_cast<int32_t>(DocumentStatus::REMOVED) ||
+        !reader.Read(rating_count) ||
+        rating_count > payload.size() / sizeof(int32_t)) {
+      return false;
+    }
+    std::vector<int> ratings(rating_count);
+    for (int &rating : ratings) {
+      int32_t value;
+      if (!reader.Read(value)) {
+        return false;
+      }
+      rating = value;
+    }
+    uint32_t text_size;
+    std::string_view text;
+    if (!reader.Read(text_size) || !reader.Read(text, text_size) ||
+        !reader.AtEnd()) {
+      return false;
+    }
+    try {
+      search_server.AddDocument(document_id, text,
+                                static_cast<DocumentStatus>(status), ratings);
+    } catch (const std::invalid_argument &) {
+      // The snapshot has the document already
+    }
+    return true;
+  }
+  if (type == REMOVE_DOCUMENTS) {
+    uint32_t count;
+    if (!reader.Read(count) || count > payload.size() / sizeof(int32_t)) {
+      return false;
+    }
+    std::vector<int> document_ids(count);
+    for (int &document_id : document_ids) {
+      int32_t value;
+      if (!reader.Read(value)) {
+        return false;
+      }
+      document_id = value;
+    }
+    if (!reader.AtEnd()) {
+      return false;
+    }
+    search_server.RemoveDocuments(document_ids);
+    return true;
+  }
+  return false;
+}
+
+bool WriteAll(int fd, const std::string &data) {
+  size_t written = 0;
+  while (written < data.size()) {
+    const ssize_t result =
+        write(fd, data.data() + written, data.size() - written);
+    if (result < 0) {
+      return false;
+    }
+    written += static_cast<size_t>(result);
+  }
+  return true;
+}
+
+} // namespace
+
+MutationLog::MutationLog(const std::string &path, MutationLogOptions options)
+    : options_(options) {
+  fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+  if (fd_ < 0) {
+    throw std::runtime_error("Can't open mutation log " + path);
+  }
+  flusher_ = std::thread([this] { FlushInBackground(); });
+}
+
+MutationLog::~MutationLog() {
+  {
+    std::lock_guard lock(mutex_);
+    stopping_ = true;
+  }
+  flush_wake_.notify_all();
+  flusher_.join();
+  close(fd_);
+}
+
+uint64_t MutationLog::LogAddDocument(int document_id,
+                                     std::string_view document,
+                                     DocumentStatus status,
+                                     const std::vector<int> &ratings) {
+  std::string payload;
+  AppendValue<int32_t>(payload, document_id);
+  AppendValue<int32_t>(payload, static_cast<int32_t>(status));
+  AppendValue<uint32_t>(payload, static_cast<uint32_t>(ratings.size()));
+  for (const int rating : ratings) {
+    AppendValue<int32_t>(payload, rating);
+  }
+  AppendValue<uint32_t>(payload, static_cast<uint32_t>(document.size()));
+  payload.append(document);
+  return Append(ADD_DOCUMENT, payload);
+}
+
+uint64_t MutationLog::LogRemoveDocuments(const std::vector<int> &document_ids) {
+  std::string payload;
+  AppendValue<uint32_t>(payload, static_cast<uint32_t>(document_ids.size()));
+  for (const int document_id : document_ids) {
+    AppendValue<int32_t>(payload, document_id);
+  }
+  return Append(REMOVE_DOCUMENTS, payload);
+}
+
+void MutationLog::WaitDurable(uint64_t sequence) {
+  std::unique_lock lock(mutex_);
+  if (options_.durability == LogDurability::EVERY_OPERATION) {
+    durable_.wait(lock, [this, sequence] { return synced_ >= sequence; });
+  }
+  if (failed_) {
+    throw std::runtime_error("Writing the mutation log has failed");
+  }
+}
+
+void MutationLog::Sync() {
+  std::unique_lock lock(mutex_);
+  const uint64_t target = logged_;
+  requested_ = target;
+  flush_wake_.notify_one();
+  durable_.wait(lock, [this, target] { return synced_ >= target; });
+  if (failed_) {
+    throw std::runtime_error("Writing the mutation log has failed");
+  }
+}
+
+void MutationLog::Truncate() {
+  std::unique_lock lock(mutex_);
+  // Records being written now must not land after the truncation
+  durable_.wait(lock, [this] { return !flushing_; });
+  buffer_.clear();
+  if (ftruncate(fd_, 0) != 0) {
+    failed_ = true;
+  }
+  synced_ = logged_;
+  requested_ = logged_;
+  durable_.notify_all();
+}
+
+uint64_t MutationLog::Append(char type, const std::string &payload) {
+  std::string record;
+  record.reserve(RECORD_HEADER_SIZE + payload.size());
+  AppendValue<uint32_t>(record, static_cast<uint32_t>(payload.size()));
+  AppendValue<uint32_t>(record, 0);
+  record.push_back(type);
+  record.append(payload);
+  const uint32_t crc = ComputeCrc32(record.data() + 8, record.size() - 8);
+  std::memcpy(record.data() + 4, &crc, sizeof(crc));
+
+  std::lock_guard lock(mutex_);
+  buffer_.append(record);
+  ++logged_;
+  if (options_.durability == LogDurability::EVERY_OPERATION ||
+      (options_.durability == LogDurability::EVERY_BATCH &&
+       logged_ - synced_ >= options_.batch_size)) {
+    requested_ = logged_;
+    flush_wake_.notify_one();
+  }
+  return logged_;
+}
+
+void MutationLog::FlushInBackground() {
+  std::unique_lock lock(mutex_);
+  const auto has_work = [this] { return stopping_ || requested_ > synced_; };
+  while (true) {
+    if (options_.durability == LogDurability::TIMER) {
+      flush_wake_.wait_for(lock, options_.sync_interval, has_work);
+    } else {
+      flush_wake_.wait(lock, has_work);
+    }
+    if (logged_ > synced_) {
+      // Records logged while this batch is written go with the next one
+      std::string data;
+      data.swap(buffer_);
+      const uint64_t target = logged_;
+      flushing_ = true;
+      lock.unlock();
+      const bool written = WriteAll(fd_, data) && fdatasync(fd_) == 0;
+      lock.lock();
+      flushing_ = false;
+      failed_ = failed_ || !written;
+      synced_ = std::max(synced_, target);
+      durable_.notify_all();
+    }
+    if (stopping_ && logged_ == synced_) {
+      return;
+    }
+  }
+}
+
+size_t MutationLog::Replay(const std::string &path,
+                           SearchServer &search_server) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    return 0;
+  }
+  const std::string log((std::istreambuf_iterator<char>(in)),
+                        std::istreambuf_iterator<char>());
+  size_t applied = 0;
+  for (size_t offset = 0; log.size() - offset >= RECORD_HEADER_SIZE;) {
+    uint32_t payload_size;
+    uint32_t crc;
+    std::memcpy(&payload_size, log.data() + offset, sizeof(payload_size));
+    std::memcpy(&crc, log.data() + offset + 4, sizeof(crc));
+    if (payload_size > log.size() - offset - RECORD_HEADER_SIZE ||
+        ComputeCrc32(log.data() + offset + 8, payload_size + 1) != crc) {
+      break;
+    }
+    const char type = log[offset + 8];
+    const std::string_view payload(log.data() + offset + RECORD_HEADER_SIZE,
+                                   payload_size);
+    if (!ApplyRecord(type, payload, search_server)) {
+      break;
+    }
+    ++applied;
+    offset += RECORD_HEADER_SIZE + payload_size;
+  }
+  return applied;
+}
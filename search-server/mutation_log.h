@@ -0,0 +1,96 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "document.h"
+
+class SearchServer;
+
+// When logged mutations reach the disk
+enum class LogDurability {
+  // Every operation waits until its record is synced. Operations logged
+  // while a sync is running share the next one (group commit)
+  EVERY_OPERATION,
+  // Records are synced once batch_size of them are waiting, a crash loses
+  // at most the last batch
+  EVERY_BATCH,
+  // Records are synced every sync_interval, a crash loses at most the last
+  // interval
+  TIMER,
+};
+
+struct MutationLogOptions {
+  LogDurability durability = LogDurability::EVERY_OPERATION;
+  size_t batch_size = 1024;
+  std::chrono::milliseconds sync_interval{100};
+};
+
+// Append-only log of AddDocument and RemoveDocument calls, replayed on top
+// of the last snapshot after a restart. Records are collected in memory and
+// written and synced by a background thread, so logging an operation costs
+// a copy of its arguments. Every record carries its length and checksum, a
+// record torn by a crash ends the replay.
+class MutationLog {
+public:
+  // Appends to the file, creating it if needed. Throws std::runtime_error
+  // if the file can't be opened
+  explicit MutationLog(const std::string &path,
+                       MutationLogOptions options = {});
+  // Syncs the records logged so far
+  ~MutationLog();
+
+  MutationLog(const MutationLog &) = delete;
+  MutationLog &operator=(const MutationLog &) = delete;
+
+  // Return the sequence number of the record
+  uint64_t LogAddDocument(int document_id, std::string_view document,
+                          DocumentStatus status,
+                          const std::vector<int> &ratings);
+  uint64_t LogRemoveDocuments(const std::vector<int> &document_ids);
+
+  // With EVERY_OPERATION durability blocks until the record is synced, with
+  // other modes returns at once. Throws std::runtime_error if writing the
+  // log has failed
+  void WaitDurable(uint64_t sequence);
+  // Writes and syncs every record logged so far
+  void Sync();
+  // Drops every record logged so far, for example once they are all in a
+  // snapshot
+  void Truncate();
+
+  // Applies the records of a log file to the server in order and returns
+  // their number. Stops at the first torn or corrupted record. Adding an
+  // existing document is skipped, so a log may be replayed over a snapshot
+  // that already has some of its records. Replay before attaching a log to
+  // the server, or the replayed records are logged again
+  static size_t Replay(const std::string &path, SearchServer &search_server);
+
+private:
+  MutationLogOptions options_;
+  int fd_ = -1;
+
+  std::mutex mutex_;
+  std::condition_variable flush_wake_;
+  std::condition_variable durable_;
+  std::string buffer_;      // records not written yet
+  uint64_t logged_ = 0;     // sequence of the last logged record
+  uint64_t synced_ = 0;     // sequence of the last synced record
+  uint64_t requested_ = 0;  // records up to this one must be synced now
+  bool flushing_ = false;
+  bool failed_ = false;
+  bool stopping_ = false;
+  std::thread flusher_;
+
+  // Appends the record of the given type and payload to buffer_ and wakes
+  // the flusher if the durability mode asks for it
+  uint64_t Append(char type, const std::string &payload);
+  void FlushInBackground();
+};
@@ -1,6 +1,30 @@
 #pragma once
 #include <cstddef>
-#include <sstream>
+#include <iostream>
+#include <iterator>
+
+// One page of the paginated container, elements keep their own type
+template <typename Iterator> class IteratorRange {
+public:
+  IteratorRange(Iterator begin, Iterator end) : begin_(begin), end_(end) {}
+  Iterator begin() const { return begin_; }
+  Iterator end() const { return end_; }
+  size_t size() const { return std::distance(begin_, end_); }
+
+private:
+  Iterator begin_;
+  Iterator end_;
+};
+
+template <typename Iterator>
+std::ostream &operator<<(std::ostream &out,
+                         const IteratorRange<Iterator> &range) {
+  for (const auto &element : range) {
+    out << element;
+  }
+  return out;
+}
+
 template <typename BeginIteratorType, typename EndIteratorType>
 class Paginator {
 public:
@@ -30,16 +54,12 @@ private:
       }
       return result;
     }
-    auto operator*() {
-      std::stringstream result;
+    auto operator*() const {
       auto current = begin;
       for (size_t count = 0; current != end && count < page_size;
            count++, current++) {
-        result << "{ document_id = " << current->id
-               << ", relevance = " << current->relevance
-               << ", rating = " << current->rating << " }";
       }
-      return result.str();
+      return IteratorRange<BeginIteratorType>{begin, current};
     }
   };
   BeginIteratorType begin_;
@@ -49,4 +69,4 @@ private:
 template <typename Container>
 auto Paginate(const Container &c, size_t page_size) {
   return Paginator(begin(c), end(c), page_size);
-}
\ No newline at end of file
+}
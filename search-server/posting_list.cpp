@@ -0,0 +1,132 @@
+#include <algorithm>
+
+#include "posting_list.h"
+
+PostingList::PostingList(CowArray<Posting> postings)
+    : postings_(std::move(postings)) {
+  for (const Posting &posting : postings_) {
+    max_term_freq_ = std::max(max_term_freq_, posting.term_freq);
+  }
+}
+
+void PostingList::Add(int ordinal, double term_freq) {
+  std::vector<Posting> &postings = postings_.Mutable();
+  // Ordinals are given out in growing order, so check the tail first
+  if (postings.empty() || postings.back().ordinal < ordinal) {
+    postings.push_back({ordinal, term_freq});
+    max_term_freq_ = std::max(max_term_freq_, term_freq);
+    return;
+  }
+  if (postings.back().ordinal == ordinal) {
+    postings.back().term_freq += term_freq;
+    max_term_freq_ = std::max(max_term_freq_, postings.back().term_freq);
+    return;
+  }
+  const auto it = postings.begin() + (LowerBound(ordinal) - begin());
+  if (it != postings.end() && it->ordinal == ordinal) {
+    it->term_freq += term_freq;
+    max_term_freq_ = std::max(max_term_freq_, it->term_freq);
+  } else {
+    postings.insert(it, {ordinal, term_freq});
+    max_term_freq_ = std::max(max_term_freq_, term_freq);
+  }
+}
+
+bool PostingList::Erase(int ordinal) {
+  const size_t position = LowerBound(ordinal) - begin();
+  if (position == postings_.size() || postings_[position].ordinal != ordinal) {
+    return false;
+  }
+  std::vector<Posting> &postings = postings_.Mutable();
+  postings.erase(postings.begin() + position);
+  ShrinkIfSparse();
+  return true;
+}
+
+bool PostingList::Contains(int ordinal) const {
+  const auto it = LowerBound(ordinal);
+  return it != postings_.end() && it->ordinal == ordinal;
+}
+
+PostingList::const_iterator PostingList::begin() const {
+  return postings_.begin();
+}
+
+PostingList::const_iterator PostingList::end() const {
+  return postings_.end();
+}
+
+size_t PostingList::size() const { return postings_.size(); }
+
+bool PostingList::empty() const { return postings_.empty(); }
+
+double PostingList::GetMaxTermFreq() const { return max_term_freq_; }
+
+size_t PostingList::MemoryUsage() const { return postings_.MemoryUsage(); }
+
+void PostingList::ShrinkIfSparse() {
+  std::vector<Posting> &postings = postings_.Mutable();
+  if (postings.size() * 4 < postings.capacity()) {
+    postings.shrink_to_fit();
+  }
+}
+
+PostingList::const_iterator PostingList::LowerBound(int ordinal) const {
+  return std::lower_bound(postings_.begin(), postings_.end(), ordinal,
+                          [](const Posting &posting, int value) {
+                            return posting.ordinal < value;
+                          });
+}
+
+PostingCursor::PostingCursor(const PostingRange &range)
+    : current_(range.first_), last_(range.last_),
+      is_compressed_(range.inverse_word_counts_ != nullptr),
+      compressed_(range.compressed_),
+      inverse_word_counts_(range.inverse_word_counts_),
+      first_ordinal_(range.first_ordinal_),
+      max_term_freq_(range.max_term_freq_) {}
+
+void PostingCursor::SkipTo(int ordinal) {
+  if (is_compressed_) {
+    compressed_.SkipTo(ordinal);
+    return;
+  }
+  if (current_ == last_ || current_->ordinal >= ordinal) {
+    return;
+  }
+  // current_ is before the ordinal, galloping finds a step past it
+  size_t step = 1;
+  const Posting *low = current_;
+  while (step < static_cast<size_t>(last_ - low) &&
+         low[step].ordinal < ordinal) {
+    low += step;
+    step *= 2;
+  }
+  const Posting *high = low + std::min(step, static_cast<size_t>(last_ - low));
+  current_ = std::lower_bound(low, high, ordinal,
+                              [](const Posting &posting, int value) {
+                                return posting.ordinal < value;
+                              });
+}
+
+void PostingCursor::SkipBlocksTo(int ordinal) {
+  if (is_compressed_) {
+    compressed_.SkipBlocksTo(ordinal);
+  } else if (current_ != last_ && last_[-1].ordinal < ordinal) {
+    current_ = last_;
+  }
+}
+
+int PostingCursor::GetBlockLastOrdinal() const {
+  if (is_compressed_) {
+    return compressed_.GetBlockLastOrdinal();
+  }
+  return current_ != last_ ? last_[-1].ordinal : END;
+}
+
+double PostingCursor::GetBlockMaxTermFreq() const {
+  if (is_compressed_) {
+    return compressed_.GetBlockMaxTermFreq();
+  }
+  return current_ != last_ ? max_term_freq_ : 0;
+}
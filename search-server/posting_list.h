@@ -0,0 +1,253 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "compressed_postings.h"
+#include "cow_array.h"
+
+// Single entry of the inverted index: ordinal of the document and TF of the
+// word in it
+struct Posting {
+  int ordinal;
+  double term_freq;
+};
+
+// Posting list of one word: postings are stored contiguously and sorted by
+// document ordinal, so scoring walks a flat array instead of tree nodes.
+// The postings may live in a mapped snapshot until the list is modified
+class PostingList {
+public:
+  using const_iterator = const Posting *;
+
+  PostingList() = default;
+  explicit PostingList(CowArray<Posting> postings);
+
+  // Adds term_freq to the posting of the document, creating it if needed.
+  // Appending documents in increasing ordinal order is O(1)
+  void Add(int ordinal, double term_freq);
+  // Returns false if there was no posting for the document
+  bool Erase(int ordinal);
+  // Erases postings of all documents matching predicate(ordinal) in a single
+  // pass over the list. Returns the number of erased postings
+  template <typename Predicate> size_t EraseIf(Predicate predicate);
+  bool Contains(int ordinal) const;
+  // First posting with ordinal not less than the given one
+  const_iterator LowerBound(int ordinal) const;
+
+  const_iterator begin() const;
+  const_iterator end() const;
+  size_t size() const;
+  bool empty() const;
+  // Not less than the TF of any posting, erasing postings keeps it
+  double GetMaxTermFreq() const;
+
+  // Bytes allocated for the postings of this list, mapped postings aren't
+  // counted
+  size_t MemoryUsage() const;
+
+private:
+  CowArray<Posting> postings_;
+  double max_term_freq_ = 0;
+
+  // Gives memory back once the list has shrunk a lot
+  void ShrinkIfSparse();
+};
+
+// Read-only postings of one word sorted by ordinal: a whole write buffer
+// list or the compressed postings of an index segment, whose TFs are
+// computed from occurrence counts and inverse word counts of the documents
+class PostingRange {
+public:
+  PostingRange() = default;
+  explicit PostingRange(const PostingList &postings);
+  // inverse_word_counts[i] is 1 / number of words of the document with
+  // ordinal first_ordinal + i
+  PostingRange(CompressedPostings postings, const double *inverse_word_counts,
+               int first_ordinal, double max_term_freq);
+
+  size_t size() const;
+  bool empty() const;
+  // Not less than the TF of any posting of the range
+  double GetMaxTermFreq() const;
+  // Calls func(ordinal, term_freq) for postings with ordinals in
+  // [first_ordinal, last_ordinal) in increasing order
+  template <typename Func>
+  void ForEach(int first_ordinal, int last_ordinal, Func func) const;
+  // Calls func(ordinal, weight) for postings roughly step apart, weight is
+  // the number of postings the sample stands for. Compressed postings are
+  // sampled once per block
+  template <typename Func> void ForEachSample(size_t step, Func func) const;
+
+private:
+  friend class PostingCursor;
+
+  const Posting *first_ = nullptr;
+  const Posting *last_ = nullptr;
+  CompressedPostings compressed_;
+  // nullptr for a write buffer list
+  const double *inverse_word_counts_ = nullptr;
+  int first_ordinal_ = 0;
+  double max_term_freq_ = 0;
+};
+
+// Forward-only position in a PostingRange for intersecting lists. SkipTo
+// gallops over write buffer postings, doubling the step until it passes the
+// ordinal and then searching the last step, so a cursor over a long list
+// costs O(log gap) per call; compressed postings skip whole blocks
+class PostingCursor {
+public:
+  // GetOrdinal() of an exhausted cursor
+  static constexpr int END = CompressedPostings::Cursor::END;
+
+  explicit PostingCursor(const PostingRange &range);
+
+  int GetOrdinal() const;
+  // TF of the current posting
+  double GetTermFreq();
+  // Moves to the first posting with ordinal not less than the given one
+  void SkipTo(int ordinal);
+  void Next();
+  // Moves to the first block with a posting not less than the ordinal,
+  // compressed postings are not unpacked. A write buffer list is one block
+  void SkipBlocksTo(int ordinal);
+  // Last ordinal and TF bound of the current block, END and 0 once the
+  // cursor is exhausted
+  int GetBlockLastOrdinal() const;
+  double GetBlockMaxTermFreq() const;
+
+private:
+  const Posting *current_;
+  const Posting *last_;
+  bool is_compressed_;
+  CompressedPostings::Cursor compressed_;
+  const double *inverse_word_counts_;
+  int first_ordinal_;
+  double max_term_freq_;
+};
+
+// Calls func(ordinal) for every ordinal in [first_ordinal, last_ordinal)
+// all the cursors have. The cursors are leapfrogged: each skips to the
+// largest ordinal seen so far, so the rarest list drives the search when
+// it goes first
+template <typename Func>
+void ForEachCommonOrdinal(std::vector<PostingCursor> &cursors,
+                          int first_ordinal, int last_ordinal, Func func);
+
+template <typename Predicate> size_t PostingList::EraseIf(Predicate predicate) {
+  const auto matches = [&predicate](const Posting &posting) {
+    return predicate(posting.ordinal);
+  };
+  // Mapped postings are copied only if there is something to erase
+  if (std::none_of(postings_.begin(), postings_.end(), matches)) {
+    return 0;
+  }
+  std::vector<Posting> &postings = postings_.Mutable();
+  const auto new_end =
+      std::remove_if(postings.begin(), postings.end(), matches);
+  const size_t erased = postings.end() - new_end;
+  postings.erase(new_end, postings.end());
+  ShrinkIfSparse();
+  return erased;
+}
+
+inline PostingRange::PostingRange(const PostingList &postings)
+    : first_(postings.begin()), last_(postings.end()),
+      max_term_freq_(postings.GetMaxTermFreq()) {}
+
+inline PostingRange::PostingRange(CompressedPostings postings,
+                                  const double *inverse_word_counts,
+                                  int first_ordinal, double max_term_freq)
+    : compressed_(postings), inverse_word_counts_(inverse_word_counts),
+      first_ordinal_(first_ordinal), max_term_freq_(max_term_freq) {}
+
+inline size_t PostingRange::size() const {
+  return inverse_word_counts_ ? compressed_.size() : last_ - first_;
+}
+
+inline bool PostingRange::empty() const { return size() == 0; }
+
+inline double PostingRange::GetMaxTermFreq() const { return max_term_freq_; }
+
+template <typename Func>
+void PostingRange::ForEach(int first_ordinal, int last_ordinal,
+                           Func func) const {
+  if (inverse_word_counts_) {
+    // The same product as in tokenising, so TFs match the write buffer
+    compressed_.ForEach(
+        first_ordinal, last_ordinal, [&](int ordinal, uint32_t count) {
+          func(ordinal,
+               count * inverse_word_counts_[ordinal - first_ordinal_]);
+        });
+    return;
+  }
+  const Posting *it = std::lower_bound(first_, last_, first_ordinal,
+                                       [](const Posting &posting, int value) {
+                                         return posting.ordinal < value;
+                                       });
+  for (; it != last_ && it->ordinal < last_ordinal; ++it) {
+    func(it->ordinal, it->term_freq);
+  }
+}
+
+template <typename Func>
+void PostingRange::ForEachSample(size_t step, Func func) const {
+  if (inverse_word_counts_) {
+    compressed_.ForEachBlock(func);
+    return;
+  }
+  for (size_t i = step; i < size(); i += step) {
+    func(first_[i].ordinal, step);
+  }
+}
+
+inline int PostingCursor::GetOrdinal() const {
+  if (is_compressed_) {
+    return compressed_.GetOrdinal();
+  }
+  return current_ != last_ ? current_->ordinal : END;
+}
+
+inline void PostingCursor::Next() {
+  if (is_compressed_) {
+    compressed_.Next();
+  } else {
+    ++current_;
+  }
+}
+
+inline double PostingCursor::GetTermFreq() {
+  if (is_compressed_) {
+    // The same product as PostingRange::ForEach
+    return compressed_.GetCount() *
+           inverse_word_counts_[compressed_.GetOrdinal() - first_ordinal_];
+  }
+  return current_->term_freq;
+}
+
+template <typename Func>
+void ForEachCommonOrdinal(std::vector<PostingCursor> &cursors,
+                          int first_ordinal, int last_ordinal, Func func) {
+  if (cursors.empty()) {
+    return;
+  }
+  int candidate = first_ordinal;
+  while (candidate < last_ordinal) {
+    bool all_match = true;
+    for (PostingCursor &cursor : cursors) {
+      cursor.SkipTo(candidate);
+      const int ordinal = cursor.GetOrdinal();
+      if (ordinal != candidate) {
+        candidate = ordinal;
+        all_match = false;
+        break;
+      }
+    }
+    if (all_match) {
+      func(candidate);
+      ++candidate;
+    }
+  }
+}
@@ -1,4 +1,5 @@
 #include "process_queries.h"
+#include "duplicate_detector.h"
 #include <algorithm>
 #include <execution>
 #include <iostream>
@@ -23,26 +24,14 @@ ProcessQueriesJoined(const SearchServer &search_server,
   return Flatten(ProcessQueries(search_server, queries));
 }
 
-void RemoveDuplicates(SearchServer &search_server, bool silent = false) {
-  std::set<int> ids_to_delete;
-  std::set<std::set<std::string_view, std::less<>>> unique_documents;
-
-  for (const int document_id : search_server) {
-    const std::map<std::string_view, double> &word_frequencies =
-        search_server.GetWordFrequencies(document_id);
-    std::set<std::string_view, std::less<>> words_of_the_document;
-    for (const auto &[word, _] : word_frequencies) {
-      words_of_the_document.insert(word);
-    }
-    // Checking if insertion was not successful
-    if (!unique_documents.insert(words_of_the_document).second) {
-      ids_to_delete.insert(document_id);
-    }
-  }
-  for (const int id : ids_to_delete) {
-    search_server.RemoveDocument(id);
-    if (!silent) {
+void RemoveDuplicates(SearchServer &search_server, bool silent,
+                      double similarity_threshold) {
+  const std::vector<int> ids_to_delete =
+      FindDuplicates(search_server, similarity_threshold);
+  if (!silent) {
+    for (const int id : ids_to_delete) {
       std::cout << "Found duplicate document id " << id << std::endl;
     }
   }
-}
\ No newline at end of file
+  search_server.RemoveDocuments(std::execution::par, ids_to_delete);
+}
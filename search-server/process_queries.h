@@ -91,4 +91,7 @@ ProcessQueriesJoined(const SearchServer &search_server,
                      const std::vector<std::string> &queries);
 
 class SearchServer;
-void RemoveDuplicates(SearchServer &search_server, bool silent);
\ No newline at end of file
+// Removes documents found by FindDuplicates, similarity_threshold below 1
+// removes near duplicates too
+void RemoveDuplicates(SearchServer &search_server, bool silent = false,
+                      double similarity_threshold = 1.0);
\ No newline at end of file
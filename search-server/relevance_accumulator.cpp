@@ -0,0 +1,32 @@
+#include "relevance_accumulator.h"
+
+void RelevanceAccumulator::Reset(int first_ordinal, size_t ordinal_count) {
+  for (const int index : touched_) {
+    relevance_[index] = 0;
+    touched_mask_[index >> 6] = 0;
+  }
+  for (const int index : excluded_) {
+    excluded_mask_[index >> 6] = 0;
+  }
+  touched_.clear();
+  excluded_.clear();
+  first_ordinal_ = first_ordinal;
+  if (relevance_.size() < ordinal_count) {
+    relevance_.resize(ordinal_count);
+    touched_mask_.resize((ordinal_count + 63) / 64);
+    excluded_mask_.resize((ordinal_count + 63) / 64);
+  }
+}
+
+void RelevanceAccumulator::Exclude(int ordinal) {
+  const int index = ordinal - first_ordinal_;
+  if (!TestBit(excluded_mask_, index)) {
+    SetBit(excluded_mask_, index);
+    excluded_.push_back(index);
+  }
+}
+
+RelevanceAccumulator &GetThreadAccumulator() {
+  thread_local RelevanceAccumulator accumulator;
+  return accumulator;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Scratch space for scoring one query: relevance lives in a dense array
+// indexed by document ordinal, touched ordinals are remembered so the array
+// is cleared in O(matched documents) instead of O(all documents).
+// Minus words exclude ordinals through a bitmask.
+// The accumulator may cover only a range of ordinals, so parallel scoring
+// tasks need buffers of their partition size only.
+// Use GetThreadAccumulator() to reuse the buffers across queries.
+class RelevanceAccumulator {
+public:
+  // Forgets the previous query and makes room for ordinals of
+  // [first_ordinal, first_ordinal + ordinal_count)
+  void Reset(int first_ordinal, size_t ordinal_count);
+
+  void Exclude(int ordinal);
+  bool IsExcluded(int ordinal) const;
+
+  void Add(int ordinal, double relevance);
+
+  // Calls func(ordinal, relevance) for every matched and not excluded
+  // document in the order they were first added
+  template <typename Func> void ForEachMatched(Func func) const;
+
+private:
+  int first_ordinal_ = 0;
+  // Indexed by ordinal - first_ordinal_
+  std::vector<double> relevance_;
+  std::vector<uint64_t> touched_mask_;
+  std::vector<uint64_t> excluded_mask_;
+  std::vector<int> touched_;
+  std::vector<int> excluded_;
+
+  static bool TestBit(const std::vector<uint64_t> &mask, int index);
+  static void SetBit(std::vector<uint64_t> &mask, int index);
+};
+
+// Accumulator owned by the calling thread
+RelevanceAccumulator &GetThreadAccumulator();
+
+inline bool RelevanceAccumulator::TestBit(const std::vector<uint64_t> &mask,
+                                          int index) {
+  return (mask[index >> 6] >> (index & 63)) & 1;
+}
+
+inline void RelevanceAccumulator::SetBit(std::vector<uint64_t> &mask,
+                                         int index) {
+  mask[index >> 6] |= uint64_t{1} << (index & 63);
+}
+
+inline bool RelevanceAccumulator::IsExcluded(int ordinal) const {
+  return TestBit(excluded_mask_, ordinal - first_ordinal_);
+}
+
+inline void RelevanceAccumulator::Add(int ordinal, double relevance) {
+  const int index = ordinal - first_ordinal_;
+  if (!TestBit(touched_mask_, index)) {
+    SetBit(touched_mask_, index);
+    touched_.push_back(index);
+  }
+  relevance_[index] += relevance;
+}
+
+template <typename Func>
+void RelevanceAccumulator::ForEachMatched(Func func) const {
+  for (const int index : touched_) {
+    if (!TestBit(excluded_mask_, index)) {
+      func(first_ordinal_ + index, relevance_[index]);
+    }
+  }
+}
@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "result_cache.h"
+
+bool ResultCacheKey::operator==(const ResultCacheKey &other) const {
+  return filter == other.filter && result_count == other.result_count &&
+         scorer == other.scorer && plus_terms == other.plus_terms &&
+         minus_terms == other.minus_terms &&
+         required_terms == other.required_terms && phrases == other.phrases;
+}
+
+size_t ResultCacheKeyHash::operator()(const ResultCacheKey &key) const {
+  // FNV-1a over the fields, the term lists are told apart by a marker
+  uint64_t hash = 14695981039346656037ull;
+  const auto mix = [&hash](uint64_t value) {
+    hash = (hash ^ value) * 1099511628211ull;
+  };
+  mix(key.filter.statuses);
+  mix(static_cast<uint32_t>(key.filter.min_rating));
+  mix(static_cast<uint32_t>(key.filter.max_rating));
+  mix(static_cast<uint32_t>(key.filter.min_document_id));
+  mix(static_cast<uint32_t>(key.filter.max_document_id));
+  mix(key.result_count);
+  mix(std::hash<std::string_view>()(key.scorer));
+  for (const TermId term : key.plus_terms) {
+    mix(term);
+  }
+  mix(UINT64_MAX);
+  for (const TermId term : key.minus_terms) {
+    mix(term);
+  }
+  mix(UINT64_MAX);
+  for (const TermId term : key.required_terms) {
+    mix(term);
+  }
+  for (const std::vector<TermId> &phrase : key.phrases) {
+    mix(UINT64_MAX);
+    for (const TermId term : phrase) {
+      mix(term);
+    }
+  }
+  return static_cast<size_t>(hash ^ hash >> 32);
+}
+
+size_t ResultCache::KeyPointerHash::operator()(
+    const ResultCacheKey *key) const {
+  return ResultCacheKeyHash()(*key);
+}
+
+bool ResultCache::KeyPointerEqual::operator()(
+    const ResultCacheKey *lhs, const ResultCacheKey *rhs) const {
+  return *lhs == *rhs;
+}
+
+ResultCache::ResultCache(size_t max_entries, size_t shard_count)
+    : shard_count_(std::max<size_t>(std::min(shard_count, max_entries), 1)) {
+  if (max_entries == 0) {
+    throw std::invalid_argument("Result cache must hold some entries.");
+  }
+  max_shard_entries_ = (max_entries + shard_count_ - 1) / shard_count_;
+  shards_ = std::make_unique<Shard[]>(shard_count_);
+}
+
+bool ResultCache::Find(const ResultCacheKey &key, uint64_t epoch,
+                       std::vector<Document> &documents) {
+  Shard &shard = GetShard(key);
+  std::lock_guard lock(shard.mutex);
+  const auto it = shard.index.find(&key);
+  if (it == shard.index.end()) {
+    ++shard.stats.misses;
+    return false;
+  }
+  const auto entry = it->second;
+  if (entry->epoch != epoch) {
+    ++shard.stats.misses;
+    ++shard.stats.stale;
+    shard.index.erase(it);
+    shard.entries.erase(entry);
+    return false;
+  }
+  ++shard.stats.hits;
+  shard.entries.splice(shard.entries.begin(), shard.entries, entry);
+  documents = entry->documents;
+  return true;
+}
+
+void ResultCache::Insert(ResultCacheKey key, uint64_t epoch,
+                         std::vector<Document> documents) {
+  Shard &shard = GetShard(key);
+  std::lock_guard lock(shard.mutex);
+  // A concurrent query may have cached the same results meanwhile
+  const auto it = shard.index.find(&key);
+  if (it != shard.index.end()) {
+    const auto entry = it->second;
+    entry->epoch = epoch;
+    entry->documents = std::move(documents);
+    shard.entries.splice(shard.entries.begin(), shard.entries, entry);
+    return;
+  }
+  if (shard.entries.size() >= max_shard_entries_) {
+    shard.index.erase(&shard.entries.back().key);
+    shard.entries.pop_back();
+    ++shard.stats.evictions;
+  }
+  shard.entries.push_front({std::move(key), epoch, std::move(documents)});
+  shard.index.emplace(&shard.entries.front().key, shard.entries.begin());
+}
+
+ResultCache::Stats ResultCache::GetStats() const {
+  Stats stats;
+  for (size_t i = 0; i < shard_count_; ++i) {
+    const Shard &shard = shards_[i];
+    std::lock_guard lock(shard.mutex);
+    stats.hits += shard.stats.hits;
+    stats.misses += shard.stats.misses;
+    stats.stale += shard.stats.stale;
+    stats.evictions += shard.stats.evictions;
+    stats.entries += shard.entries.size();
+  }
+  return stats;
+}
+
+ResultCache::Shard &ResultCache::GetShard(const ResultCacheKey &key) {
+  // The low bits pick the bucket inside the shard, the high ones the shard
+  return shards_[(ResultCacheKeyHash()(key) >> 40) % shard_count_];
+}
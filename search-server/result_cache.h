@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "document.h"
+#include "document_filter.h"
+#include "term_dictionary.h"
+
+// Identity of a status or filter query: the parsed query words, sorted and
+// without duplicates, the phrases, the name of the scorer ranking them, the
+// filter and the number of results asked for
+struct ResultCacheKey {
+  std::vector<TermId> plus_terms;
+  std::vector<TermId> minus_terms;
+  std::vector<TermId> required_terms;
+  std::vector<std::vector<TermId>> phrases;
+  std::string_view scorer; // static name, never dangles
+  DocumentFilter filter;
+  size_t result_count = 0;
+
+  bool operator==(const ResultCacheKey &other) const;
+};
+
+struct ResultCacheKeyHash {
+  size_t operator()(const ResultCacheKey &key) const;
+};
+
+// Least recently used results of FindTopDocuments. Keys are spread over
+// shards with a mutex and an LRU list each, so concurrent queries mostly
+// lock different shards; a shard holds its share of the entries and evicts
+// its own least recently used one. Every entry remembers the epoch of the
+// index it was computed at and is stale once the index changes, the server
+// bumps the epoch on every modification and no entry is cleared eagerly
+class ResultCache {
+public:
+  struct Stats {
+    uint64_t hits = 0;
+    // Stale entries count as misses too
+    uint64_t misses = 0;
+    uint64_t stale = 0;
+    uint64_t evictions = 0;
+    size_t entries = 0;
+  };
+
+  static const size_t DEFAULT_SHARD_COUNT = 16;
+
+  // Throws std::invalid_argument if max_entries is zero
+  explicit ResultCache(size_t max_entries,
+                       size_t shard_count = DEFAULT_SHARD_COUNT);
+
+  // Copies the cached documents if the key was cached at the epoch
+  bool Find(const ResultCacheKey &key, uint64_t epoch,
+            std::vector<Document> &documents);
+  void Insert(ResultCacheKey key, uint64_t epoch,
+              std::vector<Document> documents);
+
+  Stats GetStats() const;
+
+private:
+  struct Entry {
+    ResultCacheKey key;
+    uint64_t epoch;
+    std::vector<Document> documents;
+  };
+
+  // Hashes and compares the keys pointed to
+  struct KeyPointerHash {
+    size_t operator()(const ResultCacheKey *key) const;
+  };
+  struct KeyPointerEqual {
+    bool operator()(const ResultCacheKey *lhs,
+                    const ResultCacheKey *rhs) const;
+  };
+
+  struct Shard {
+    mutable std::mutex mutex;
+    std::list<Entry> entries; // most recently used first
+    // Keys point into entries
+    std::unordered_map<const ResultCacheKey *, std::list<Entry>::iterator,
+                       KeyPointerHash, KeyPointerEqual>
+        index;
+    Stats stats;
+  };
+
+  size_t max_shard_entries_;
+  std::unique_ptr<Shard[]> shards_;
+  size_t shard_count_;
+
+  Shard &GetShard(const ResultCacheKey &key);
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <string_view>
+
+// Statistics of the live documents a scorer is built from per query
+struct CorpusStats {
+  size_t document_count = 0;
+  // log(document_count), kept up to date by the server
+  double log_document_count = 0;
+  // Words per document, stop words don't count
+  double average_word_count = 0;
+};
+
+// Ranking models for SearchServer::FindTopDocuments<Scorer>. Relevance of a
+// document is the sum over the plus words it has of
+// Score(GetWordWeight(...), TF, 1 / number of words of the document). Score
+// must not decrease with TF and GetMaxScore must bound it for every TF up to
+// max_term_freq and any length, the bounds skip documents while pruning.
+// Everything is inline, so the scoring loops have no calls per posting
+
+// log(number of documents / number of documents with the word) times TF
+class TfIdfScorer {
+public:
+  // Key of the cached results
+  static constexpr std::string_view NAME = "tf-idf";
+
+  explicit TfIdfScorer(const CorpusStats &stats)
+      : log_document_count_(stats.log_document_count) {}
+
+  double GetWordWeight(size_t, double log_document_freq) const {
+    return log_document_count_ - log_document_freq;
+  }
+  double Score(double word_weight, double term_freq, double) const {
+    return term_freq * word_weight;
+  }
+  double GetMaxScore(double word_weight, double max_term_freq) const {
+    return max_term_freq * word_weight;
+  }
+
+private:
+  double log_document_count_;
+};
+
+// Okapi BM25 with k1 = 1.2 and b = 0.75. With TF = count / length the
+// term count * (k1 + 1) / (count + k1 * (1 - b + b * length / average))
+// is TF * (k1 + 1) / (TF + k1 * (1 - b) / length + k1 * b / average), so
+// the stored TFs and inverse lengths of the documents serve as they are
+class Bm25Scorer {
+public:
+  static constexpr std::string_view NAME = "bm25";
+  static constexpr double K1 = 1.2;
+  static constexpr double B = 0.75;
+
+  explicit Bm25Scorer(const CorpusStats &stats)
+      : document_count_(static_cast<double>(stats.document_count)),
+        average_norm_(stats.average_word_count > 0
+                          ? K1 * B / stats.average_word_count
+                          : 0) {}
+
+  // IDF of BM25, the weight includes k1 + 1
+  double GetWordWeight(size_t document_freq, double) const {
+    const double freq = static_cast<double>(document_freq);
+    return log(1 + (document_count_ - freq + 0.5) / (freq + 0.5)) * (K1 + 1);
+  }
+  double Score(double word_weight, double term_freq,
+               double inverse_word_count) const {
+    return word_weight * term_freq /
+           (term_freq + K1 * (1 - B) * inverse_word_count + average_norm_);
+  }
+  // The length term is never negative, so it's left out
+  double GetMaxScore(double word_weight, double max_term_freq) const {
+    return max_term_freq > 0
+               ? word_weight * max_term_freq / (max_term_freq + average_norm_)
+               : 0;
+  }
+
+private:
+  double document_count_;
+  double average_norm_;
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <algorithm>
+#include <execution>
+#include <string>
+#include <vector>
+
+#include "search_server.h"
+
+// Continuation over the results of one query: every NextPage() returns the
+// next page_size documents. Selected results are kept between calls and the
+// selection depth doubles when it runs out, so reading N pages costs
+// O(log N) top-k passes instead of one pass per page. Pages reflect the
+// index at the moment of the last selection.
+template <typename PredicateT> class SearchCursor {
+public:
+  SearchCursor(const SearchServer &search_server, std::string raw_query,
+               PredicateT predicate, size_t page_size);
+
+  // Empty result means the query has no more documents
+  std::vector<Document> NextPage();
+  bool HasMore();
+  // Number of documents returned so far
+  size_t GetOffset() const;
+
+private:
+  const SearchServer &search_server_;
+  std::string raw_query_;
+  PredicateT predicate_;
+  size_t page_size_;
+  size_t offset_ = 0;
+  std::vector<Document> selected_;
+  bool exhausted_ = false;
+
+  // Makes sure selected_ holds at least result_count documents or everything
+  // the query matches
+  void Select(size_t result_count);
+};
+
+template <typename PredicateT>
+SearchCursor<PredicateT>::SearchCursor(const SearchServer &search_server,
+                                       std::string raw_query,
+                                       PredicateT predicate, size_t page_size)
+    : search_server_(search_server), raw_query_(std::move(raw_query)),
+      predicate_(predicate), page_size_(page_size) {}
+
+template <typename PredicateT>
+std::vector<Document> SearchCursor<PredicateT>::NextPage() {
+  Select(offset_ + page_size_);
+  const size_t page_end = std::min(offset_ + page_size_, selected_.size());
+  std::vector<Document> page(selected_.begin() + offset_,
+                             selected_.begin() + page_end);
+  offset_ = page_end;
+  return page;
+}
+
+template <typename PredicateT> bool SearchCursor<PredicateT>::HasMore() {
+  Select(offset_ + 1);
+  return offset_ < selected_.size();
+}
+
+template <typename PredicateT>
+size_t SearchCursor<PredicateT>::GetOffset() const {
+  return offset_;
+}
+
+template <typename PredicateT>
+void SearchCursor<PredicateT>::Select(size_t result_count) {
+  if (exhausted_ || selected_.size() >= result_count) {
+    return;
+  }
+  const size_t depth = std::max(result_count, selected_.size() * 2);
+  selected_ = search_server_.FindTopDocuments(std::execution::seq, raw_query_,
+                                              predicate_, depth);
+  exhausted_ = selected_.size() < depth;
+}
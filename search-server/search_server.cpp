@@ -1,40 +1,41 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <unistd.h>
+
 #include "read_input_functions.h"
 #include "search_server.h"
+#include "snapshot_format.h"
 #include "string_processing.h"
 
-bool AlmostEqualRelative(double A, double B, double maxRelDiff) {
-  // Calculate the difference.
-  double diff = fabs(A - B);
-  A = fabs(A);
-  B = fabs(B);
-  // Find the largest
-  double largest = (B > A) ? B : A;
-
-  if (diff <= largest * maxRelDiff) {
-    return true;
-  }
-  return false;
-}
-
 SearchServer::SearchServer(const std::string &text) {
   for (const std::string &word : SplitIntoWords(text)) {
-    if (!IsValidWord(word)) {
-      throw std::invalid_argument("Invalid symbols in the list of stop words.");
-    }
-    if (!word.empty()) {
-      stop_words_.insert(word);
-    }
+    AddStopWord(word);
   }
 }
 
 SearchServer::SearchServer(const std::string_view text) {
   for (const std::string_view word : SplitIntoWords(text)) {
-    if (!IsValidWord(word)) {
-      throw std::invalid_argument("Invalid symbols in the list of stop words.");
+    AddStopWord(word);
+  }
+}
+
+SearchServer::~SearchServer() {
+  if (compactor_.joinable()) {
+    {
+      std::unique_lock lock(index_mutex_);
+      stop_compaction_ = true;
     }
-    if (!word.empty()) {
-      stop_words_.insert(std::string(word));
+    compaction_wake_.notify_all();
+    compactor_.join();
+  }
+  if (merger_.joinable()) {
+    {
+      std::unique_lock lock(index_mutex_);
+      stop_merging_ = true;
     }
+    merge_wake_.notify_all();
+    merger_.join();
   }
 }
 
@@ -46,23 +47,71 @@ void SearchServer::AddDocument(int document_id, const std::string_view document,
   if (document_id < 0) {
     throw std::invalid_argument("Invalid document ID.");
   }
-  if (documents_.count(document_id) > 0) {
-    throw std::invalid_argument(
-        "Document with the given ID is already existing.");
+  // The text is split while queries may go on, the exclusive lock is taken
+  // only to put the words into the index
+  std::vector<std::string_view> words;
+  uint64_t stop_words_version;
+  {
+    std::shared_lock lock(index_mutex_);
+    CheckNewDocumentId(document_id);
+    words = SplitIntoWordsNoStop(document);
+    stop_words_version = stop_words_version_;
   }
-  storage_.emplace_back(document);
-  document_ids_.insert(document_id);
-  const std::vector<std::string_view> words =
-      SplitIntoWordsNoStop(std::string_view{storage_.back()});
-  const double inv_word_count = 1.0 / words.size();
+  std::unique_lock lock(index_mutex_);
+  CheckNewDocumentId(document_id);
+  if (stop_words_version != stop_words_version_) {
+    words = SplitIntoWordsNoStop(document);
+  }
+  const int ordinal = static_cast<int>(documents_.size());
+  // The dictionary copies the words, the document text isn't kept
+  std::vector<TermId> terms;
+  terms.reserve(words.size());
   for (const std::string_view word : words) {
-    if (!IsStopWord(word)) {
-      word_to_document_freqs_[word][document_id] += inv_word_count;
-      id_to_word_freqs_[document_id][word] += inv_word_count;
-    }
+    terms.push_back(InternTerm(word));
+  }
+  std::vector<TermFreq> document_terms = CountTermFreqs(terms);
+  for (const auto &[term, term_freq] : document_terms) {
+    AddPosting(term, ordinal, term_freq);
+    dictionary_.AddReference(term);
+  }
+  document_ids_.insert(document_id);
+  documents_.push_back(DocumentData{
+      document_id, ComputeAverageRating(ratings), status,
+      static_cast<uint32_t>(words.size()),
+      ComputeInverseWordCount(words.size())});
+  filter_columns_.Add(document_id, status, documents_.back().rating);
+  live_word_count_ += words.size();
+  tombstones_.push_back(false);
+  document_positions_.emplace_back(CollectPositions(terms, document_terms));
+  document_terms_.emplace_back(std::move(document_terms));
+  document_ordinals_.emplace(document_id, ordinal);
+  OnDocumentsChanged();
+  SealWriteBufferIfFull();
+  LoggedMutation logged;
+  if (mutation_log_) {
+    logged.log = mutation_log_;
+    logged.sequence =
+        mutation_log_->LogAddDocument(document_id, document, status, ratings);
   }
-  documents_.emplace(document_id,
-                     DocumentData{ComputeAverageRating(ratings), status});
+  lock.unlock();
+  WaitDurable(logged);
+}
+
+void SearchServer::AddDocuments(const std::vector<NewDocument> &documents) {
+  AddDocuments(std::execution::seq, documents);
+}
+
+void SearchServer::AddDocuments(const std::execution::sequenced_policy &,
+                                const std::vector<NewDocument> &documents) {
+  AddDocumentsInSlices(documents, 1);
+}
+
+void SearchServer::AddDocuments(const std::execution::parallel_policy &,
+                                const std::vector<NewDocument> &documents) {
+  const size_t slice_count = std::min(
+      std::max<size_t>(std::thread::hardware_concurrency(), 1) * 4,
+      documents.size() / MIN_INGESTION_SLICE_DOCUMENTS + 1);
+  AddDocumentsInSlices(documents, slice_count);
 }
 
 void SearchServer::RemoveDocument(int document_id) {
@@ -71,84 +120,212 @@ void SearchServer::RemoveDocument(int document_id) {
 
 void SearchServer::RemoveDocument(const std::execution::sequenced_policy &,
                                   int document_id) {
-  // Trying to delete unexisting document.
-  if (!id_to_word_freqs_.count(document_id)) {
-    return;
+  std::unique_lock lock(index_mutex_);
+  const LoggedMutation logged = LogRemoval({document_id});
+  if (soft_delete_) {
+    DeferRemoval({document_id});
+  } else {
+    EraseDocument(std::execution::seq, document_id);
   }
-  // Clearing the set of document IDs
-  document_ids_.erase(document_id);
-  // Clearing the word to doc_ID_freqs index
-  for (const auto &[word, _] : id_to_word_freqs_.at(document_id)) {
-    std::map<int, double> &document_freqs = word_to_document_freqs_.at(word);
-    document_freqs.erase(document_id);
-    // If the word is empty, erasing the word itself
-    if (document_freqs.empty()) {
-      word_to_document_freqs_.erase(word);
-    }
-  }
-  // Clearing the ID to word_freqs index
-  id_to_word_freqs_.erase(document_id);
-  // Clearing documents map
-  documents_.erase(document_id);
+  lock.unlock();
+  WaitDurable(logged);
 }
 
 void SearchServer::RemoveDocument(const std::execution::parallel_policy &,
                                   int document_id) {
-  // Trying to delete unexisting document.
-  if (!id_to_word_freqs_.count(document_id)) {
-    return;
+  std::unique_lock lock(index_mutex_);
+  const LoggedMutation logged = LogRemoval({document_id});
+  if (soft_delete_) {
+    DeferRemoval({document_id});
+  } else {
+    EraseDocument(std::execution::par, document_id);
   }
-  // Clearing the set of document IDs
-  document_ids_.erase(document_id);
-  // Clearing the word to doc_ID_freqs index
-  std::map<std::string_view, double> &words_ref =
-      id_to_word_freqs_.at(document_id);
-  std::for_each(std::execution::par, words_ref.begin(), words_ref.end(),
-                [&](const std::pair<std::string_view, double> &word_TF) {
-                  word_to_document_freqs_.at(word_TF.first).erase(document_id);
-                });
-  // Clearing the ID to word_freqs index
-  id_to_word_freqs_.erase(document_id);
-  // Clearing documents map
-  documents_.erase(document_id);
+  lock.unlock();
+  WaitDurable(logged);
 }
 
-std::vector<Document>
-SearchServer::FindTopDocuments(const std::string_view raw_query,
-                               DocumentStatus status) const {
-  const auto lambda = [status](int, DocumentStatus status1, int) {
-    return status1 == status;
-  };
-  return FindTopDocuments(raw_query, lambda);
+void SearchServer::RemoveDocuments(const std::vector<int> &document_ids) {
+  RemoveDocuments(std::execution::seq, document_ids);
 }
 
-std::vector<Document>
-SearchServer::FindTopDocuments(const std::string_view raw_query) const {
-  const auto lambda = [](int, DocumentStatus status, int) {
-    return status == DocumentStatus::ACTUAL;
-  };
-  return FindTopDocuments(raw_query, lambda);
+void SearchServer::RemoveDocuments(const std::execution::sequenced_policy &,
+                                   const std::vector<int> &document_ids) {
+  std::unique_lock lock(index_mutex_);
+  const LoggedMutation logged = LogRemoval(document_ids);
+  if (soft_delete_) {
+    DeferRemoval(document_ids);
+  } else {
+    const RemovalBatch batch = PrepareRemoval(document_ids);
+    for (const TermId term : batch.terms) {
+      CompactPostings(term);
+    }
+    FinishRemoval(batch);
+  }
+  lock.unlock();
+  WaitDurable(logged);
+}
+
+void SearchServer::RemoveDocuments(const std::execution::parallel_policy &,
+                                   const std::vector<int> &document_ids) {
+  std::unique_lock lock(index_mutex_);
+  const LoggedMutation logged = LogRemoval(document_ids);
+  if (soft_delete_) {
+    DeferRemoval(document_ids);
+  } else {
+    const RemovalBatch batch = PrepareRemoval(document_ids);
+    // Every term owns its own list, only the tombstones are shared
+    std::for_each(std::execution::par, batch.terms.begin(), batch.terms.end(),
+                  [this](TermId term) { CompactPostings(term); });
+    FinishRemoval(batch);
+  }
+  lock.unlock();
+  WaitDurable(logged);
+}
+
+void SearchServer::SetMutationLog(std::shared_ptr<MutationLog> mutation_log) {
+  std::unique_lock lock(index_mutex_);
+  mutation_log_ = std::move(mutation_log);
+}
+
+void SearchServer::SetDynamicPruning(bool enabled) {
+  std::unique_lock lock(index_mutex_);
+  dynamic_pruning_ = enabled;
+}
+
+void SearchServer::SetSoftDelete(bool enabled) {
+  std::unique_lock lock(index_mutex_);
+  soft_delete_ = enabled;
+  if (enabled && !compactor_.joinable()) {
+    compactor_ = std::thread([this] { CompactInBackground(); });
+  }
+}
+
+void SearchServer::SetWriteBufferSize(size_t max_postings) {
+  std::unique_lock lock(index_mutex_);
+  max_buffer_postings_ = std::max<size_t>(max_postings, 1);
+  SealWriteBufferIfFull();
+}
+
+void SearchServer::WaitForMerges() {
+  std::unique_lock lock(index_mutex_);
+  merge_done_.wait(lock, [this] {
+    const auto [first, last] = PickSegmentsToMerge();
+    return !merging_ && first == last;
+  });
+}
+
+size_t SearchServer::GetSegmentCount() const {
+  std::shared_lock lock(index_mutex_);
+  return segments_.size();
+}
+
+void SearchServer::WaitForCompaction() {
+  std::unique_lock lock(index_mutex_);
+  compaction_done_.wait(lock, [this] {
+    return pending_removals_.empty() && !compacting_;
+  });
+}
+
+void SearchServer::SetResultCacheSize(size_t max_entries) {
+  std::unique_lock lock(index_mutex_);
+  result_cache_ =
+      max_entries > 0 ? std::make_unique<ResultCache>(max_entries) : nullptr;
+}
+
+ResultCache::Stats SearchServer::GetResultCacheStats() const {
+  std::shared_lock lock(index_mutex_);
+  return result_cache_ ? result_cache_->GetStats() : ResultCache::Stats{};
+}
+
+void SearchServer::SetScoringConcurrency(size_t concurrency) {
+  std::unique_lock lock(index_mutex_);
+  scoring_pool_ =
+      std::make_shared<WorkStealingPool>(std::max<size_t>(concurrency, 1) - 1);
 }
 
 int SearchServer::GetDocumentCount() const {
-  return static_cast<int>(documents_.size());
+  std::shared_lock lock(index_mutex_);
+  return static_cast<int>(document_ordinals_.size());
+}
+
+SearchServer::StorageStats SearchServer::GetStorageStats() const {
+  std::shared_lock lock(index_mutex_);
+  StorageStats stats;
+  stats.word_bytes_held = dictionary_.GetBytesHeld();
+  stats.word_bytes_live = dictionary_.GetBytesLive();
+  for (const TermData &term_data : terms_) {
+    stats.posting_bytes_held += term_data.postings.MemoryUsage();
+    stats.posting_bytes_live += term_data.document_freq * sizeof(Posting);
+  }
+  for (const SegmentEntry &entry : segments_) {
+    stats.posting_bytes_held += entry.segment->MemoryUsage();
+  }
+  for (const DocumentTerms &document_terms : document_terms_) {
+    stats.forward_index_bytes_held +=
+        sizeof(document_terms) + document_terms.MemoryUsage();
+    stats.forward_index_bytes_live += document_terms.size() * sizeof(TermFreq);
+  }
+  for (const DocumentPositions &positions : document_positions_) {
+    stats.forward_index_bytes_held +=
+        sizeof(positions) + positions.MemoryUsage();
+    stats.forward_index_bytes_live += positions.size() * sizeof(uint32_t);
+  }
+  stats.snapshot_bytes_mapped = snapshot_ ? snapshot_->size() : 0;
+  return stats;
 }
 
-// Returns reference to a map of words and their TFs of the current document
-const std::map<std::string_view, double> &
+size_t SearchServer::GetPostingsMemoryUsage() const {
+  std::shared_lock lock(index_mutex_);
+  size_t bytes = 0;
+  for (const TermData &term_data : terms_) {
+    bytes += term_data.postings.MemoryUsage();
+  }
+  for (const SegmentEntry &entry : segments_) {
+    bytes += entry.segment->MemoryUsage();
+  }
+  return bytes;
+}
+
+// Returns map of words and their TFs of the current document
+std::map<std::string_view, double>
 SearchServer::GetWordFrequencies(int document_id) const {
-  static std::map<std::string_view, double> empty_map;
-  if (id_to_word_freqs_.count(document_id) == 0) {
-    return empty_map;
+  std::shared_lock lock(index_mutex_);
+  std::map<std::string_view, double> word_freqs;
+  const auto ordinal_it = document_ordinals_.find(document_id);
+  if (ordinal_it == document_ordinals_.end()) {
+    return word_freqs;
+  }
+  for (const auto &[term, term_freq] : document_terms_[ordinal_it->second]) {
+    word_freqs.emplace(dictionary_.GetWord(term), term_freq);
+  }
+  return word_freqs;
+}
+
+std::vector<TermId> SearchServer::GetDocumentTerms(int document_id) const {
+  std::shared_lock lock(index_mutex_);
+  std::vector<TermId> terms;
+  const auto ordinal_it = document_ordinals_.find(document_id);
+  if (ordinal_it == document_ordinals_.end()) {
+    return terms;
+  }
+  const DocumentTerms &document_terms = document_terms_[ordinal_it->second];
+  terms.reserve(document_terms.size());
+  for (const auto &[term, _] : document_terms) {
+    terms.push_back(term);
   }
-  return id_to_word_freqs_.at(document_id);
+  return terms;
+}
+
+std::vector<int> SearchServer::GetDocumentIds() const {
+  std::shared_lock lock(index_mutex_);
+  return {document_ids_.begin(), document_ids_.end()};
 }
 
-std::set<int>::const_iterator SearchServer::begin() {
+std::set<int>::const_iterator SearchServer::begin() const {
   return document_ids_.begin();
 }
 
-std::set<int>::const_iterator SearchServer::end() {
+std::set<int>::const_iterator SearchServer::end() const {
   return document_ids_.end();
 }
 
@@ -157,32 +334,30 @@ std::set<int>::const_iterator SearchServer::end() {
 std::tuple<std::vector<std::string_view>, DocumentStatus>
 SearchServer::MatchDocument(const std::string_view raw_query,
                             int document_id) const {
-  const DocumentStatus status = documents_.at(document_id).status;
+  std::shared_lock lock(index_mutex_);
+  const int ordinal = document_ordinals_.at(document_id);
+  const DocumentStatus status = documents_[ordinal].status;
   std::vector<std::string_view> matched_words;
   if (raw_query.empty()) {
     return tie(matched_words, status);
   }
 
-  const Query query = ParseQuery(std::execution::seq, raw_query);
+  const Query query = ParseQuery(raw_query);
   // Refs for easier readability
-  const std::vector<std::string_view> &plus_words = query.plus_words;
-  const std::vector<std::string_view> &minus_words = query.minus_words;
-
-  if (std::any_of(minus_words.begin(), minus_words.end(),
-                  [&](const std::string_view &word) {
-                    return word_to_document_freqs_.count(word) > 0 &&
-                           word_to_document_freqs_.at(word).count(
-                               document_id) != 0;
-                  })) {
+  const std::vector<TermId> &plus_terms = query.plus_terms;
+  const std::vector<TermId> &minus_terms = query.minus_terms;
+
+  if (std::any_of(minus_terms.begin(), minus_terms.end(), [&](TermId term) {
+        return DocumentHasTerm(term, ordinal);
+      }) ||
+      !DocumentHasRequired(query, ordinal)) {
     return tie(matched_words, status);
   }
-  std::for_each(
-      plus_words.begin(), plus_words.end(), [&](const std::string_view word) {
-        if (word_to_document_freqs_.count(word) != 0 &&
-            word_to_document_freqs_.at(word).count(document_id) != 0) {
-          matched_words.emplace_back(word);
-        }
-      });
+  std::vector<TermId> matched_terms;
+  std::copy_if(plus_terms.begin(), plus_terms.end(),
+               std::back_inserter(matched_terms),
+               [&](TermId term) { return DocumentHasTerm(term, ordinal); });
+  matched_words = GetSortedWords(matched_terms);
   return tie(matched_words, status);
 }
 
@@ -197,78 +372,1026 @@ std::tuple<std::vector<std::string_view>, DocumentStatus>
 SearchServer::MatchDocument(const std::execution::parallel_policy &,
                             const std::string_view raw_query,
                             int document_id) const {
-  Query query = ParseQuery(std::execution::par, raw_query);
+  std::shared_lock lock(index_mutex_);
+  Query query = ParseQuery(raw_query);
 
   // Refs for easier readability
-  const DocumentStatus status = documents_.at(document_id).status;
-  const std::vector<std::string_view> &plus_words = query.plus_words;
-  const std::vector<std::string_view> &minus_words = query.minus_words;
+  const int ordinal = document_ordinals_.at(document_id);
+  const DocumentStatus status = documents_[ordinal].status;
+  const std::vector<TermId> &plus_terms = query.plus_terms;
+  const std::vector<TermId> &minus_terms = query.minus_terms;
 
   std::vector<std::string_view> matched_words;
   // If there are any minus_words in the document, return empty result
   // It seems like there are too few minus_words, using ::par here only slows
   // algorythm
-  if (std::any_of(/*std::execution::par,*/
-                  minus_words.begin(), minus_words.end(),
-                  [&](const std::string_view &word) {
-                    return word_to_document_freqs_.count(word) > 0 &&
-                           word_to_document_freqs_.at(word).count(document_id) >
-                               0;
-                  })) {
+  if (std::any_of(minus_terms.begin(), minus_terms.end(), [&](TermId term) {
+        return DocumentHasTerm(term, ordinal);
+      }) ||
+      !DocumentHasRequired(query, ordinal)) {
     return tie(matched_words, status);
   }
-  matched_words.resize(plus_words.size());
-  const std::vector<std::string_view>::iterator end_copy_it = std::copy_if(
-      std::execution::par,
-      // I tested both copy and move, and copy is faster in general
-      /*std::make_move_iterator(plus_words.begin()),
-      std::make_move_iterator(plus_words.end()),*/
-      plus_words.begin(), plus_words.end(), matched_words.begin(),
-      [&](const std::string_view word) {
-        return word_to_document_freqs_.count(word) > 0 &&
-               word_to_document_freqs_.at(word).count(document_id) > 0;
-      });
-  // Removing duplicates
-  matched_words.resize(std::distance(matched_words.begin(), end_copy_it));
-  std::sort(matched_words.begin(), matched_words.end());
-  const std::vector<std::string_view>::iterator end_unique_it =
-      std::unique(matched_words.begin(), matched_words.end());
-  matched_words.erase(end_unique_it, matched_words.end());
+  std::vector<TermId> matched_terms(plus_terms.size());
+  const auto end_copy_it = std::copy_if(
+      std::execution::par, plus_terms.begin(), plus_terms.end(),
+      matched_terms.begin(),
+      [&](TermId term) { return DocumentHasTerm(term, ordinal); });
+  matched_terms.erase(end_copy_it, matched_terms.end());
+  matched_words = GetSortedWords(matched_terms);
 
   return tie(matched_words, status);
 }
 
+void SearchServer::SaveSnapshot(const std::string &path) const {
+  static_assert(sizeof(TermFreq) == 16);
+  std::shared_lock lock(index_mutex_);
+  // Live documents get dense ordinals in the snapshot, postings of removed
+  // ones are dropped
+  std::vector<int> ordinals;
+  for (const auto &[_, ordinal] : document_ordinals_) {
+    ordinals.push_back(ordinal);
+  }
+  std::sort(ordinals.begin(), ordinals.end());
+  std::vector<int> new_ordinals(documents_.size(), -1);
+  std::vector<uint32_t> references(terms_.size());
+  for (size_t i = 0; i < ordinals.size(); ++i) {
+    new_ordinals[ordinals[i]] = static_cast<int>(i);
+    for (const auto &[term, _] : document_terms_[ordinals[i]]) {
+      ++references[term];
+    }
+  }
+
+  // Every saving thread writes its own file, concurrent saves to one path
+  // don't mix their contents
+  const std::string temp_path =
+      path + ".tmp." + std::to_string(getpid()) + "." +
+      std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+  std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+  const auto write = [&out](const void *data, size_t size) {
+    out.write(static_cast<const char *>(data), size);
+  };
+  // Pads the file to a multiple of 8 and returns the offset
+  const auto align = [&out]() {
+    const uint64_t offset = out.tellp();
+    const char zeros[8] = {};
+    out.write(zeros, (8 - offset % 8) % 8);
+    return static_cast<uint64_t>(out.tellp());
+  };
+
+  SnapshotHeader header = {};
+  std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+  header.version = SNAPSHOT_VERSION;
+  header.term_count = static_cast<uint32_t>(terms_.size());
+  header.document_count = ordinals.size();
+  std::vector<SnapshotTerm> snapshot_terms(terms_.size());
+  // Header and terms are written last, when the offsets are known
+  out.seekp(sizeof(header) + snapshot_terms.size() * sizeof(SnapshotTerm));
+  header.terms_offset = sizeof(header);
+
+  header.words_offset = align();
+  for (TermId term = 0; term < terms_.size(); ++term) {
+    SnapshotTerm &snapshot_term = snapshot_terms[term];
+    snapshot_term.is_stop_word = terms_[term].is_stop_word;
+    snapshot_term.references = references[term] + terms_[term].is_stop_word;
+    if (snapshot_term.references > 0) {
+      const std::string_view word = dictionary_.GetWord(term);
+      snapshot_term.word_offset = header.words_size;
+      snapshot_term.word_size = static_cast<uint32_t>(word.size());
+      write(word.data(), word.size());
+      header.words_size += word.size();
+    }
+  }
+
+  // The postings of the whole index are packed into one segment
+  IndexSegment::Builder builder;
+  for (TermId term = 0; term < terms_.size(); ++term) {
+    const auto add = [&](int ordinal, double term_freq) {
+      if (new_ordinals[ordinal] >= 0) {
+        builder.Add(term, new_ordinals[ordinal],
+                    CountOccurrences(term_freq, documents_[ordinal]),
+                    term_freq);
+      }
+    };
+    // Segments and the buffer follow each other in ordinal order
+    for (const SegmentEntry &entry : segments_) {
+      entry.segment->Find(term).ForEach(0, buffer_first_ordinal_, add);
+    }
+    PostingRange(terms_[term].postings)
+        .ForEach(buffer_first_ordinal_, static_cast<int>(documents_.size()),
+                 add);
+  }
+  const IndexSegment segment =
+      builder.Build(0, static_cast<int>(ordinals.size()), {});
+  header.postings_offset = align();
+  for (const SegmentTerm &segment_term : segment.GetTerms()) {
+    snapshot_terms[segment_term.term].first_word = segment_term.first_word;
+    snapshot_terms[segment_term.term].posting_count =
+        segment_term.posting_count;
+  }
+  const CowArray<uint32_t> &posting_data = segment.GetData();
+  write(posting_data.begin(), posting_data.size() * sizeof(uint32_t));
+  header.posting_words = posting_data.size();
+
+  header.documents_offset = align();
+  for (const int ordinal : ordinals) {
+    const DocumentData &document = documents_[ordinal];
+    const SnapshotDocument snapshot_document = {
+        document.id,
+        document.rating,
+        static_cast<int32_t>(document.status),
+        document.word_count,
+        header.document_term_count,
+        document_terms_[ordinal].size(),
+        header.document_position_count};
+    write(&snapshot_document, sizeof(snapshot_document));
+    header.document_term_count += document_terms_[ordinal].size();
+    header.document_position_count += document_positions_[ordinal].size();
+  }
+
+  header.document_terms_offset = align();
+  for (const int ordinal : ordinals) {
+    const DocumentTerms &document_terms = document_terms_[ordinal];
+    write(document_terms.begin(), document_terms.size() * sizeof(TermFreq));
+  }
+
+  header.document_positions_offset = align();
+  for (const int ordinal : ordinals) {
+    const DocumentPositions &positions = document_positions_[ordinal];
+    write(positions.begin(), positions.size() * sizeof(uint32_t));
+  }
+
+  header.file_size = out.tellp();
+  out.seekp(0);
+  write(&header, sizeof(header));
+  write(snapshot_terms.data(), snapshot_terms.size() * sizeof(SnapshotTerm));
+  out.close();
+  if (!out || std::rename(temp_path.c_str(), path.c_str()) != 0) {
+    std::remove(temp_path.c_str());
+    throw std::runtime_error("Can't write snapshot " + path);
+  }
+  // Modifications wait for the lock, nothing is logged in between
+  if (mutation_log_) {
+    mutation_log_->Truncate();
+  }
+}
+
+void SearchServer::LoadSnapshot(const std::string &path) {
+  auto snapshot = std::make_shared<const MappedFile>(path);
+  const char *data = snapshot->data();
+  const uint64_t size = snapshot->size();
+  SnapshotHeader header;
+  if (size < sizeof(header)) {
+    throw std::invalid_argument("Not a search server snapshot: " + path);
+  }
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) {
+    throw std::invalid_argument("Not a search server snapshot: " + path);
+  }
+  if (header.version != SNAPSHOT_VERSION) {
+    throw std::invalid_argument("Unsupported snapshot version " +
+                                std::to_string(header.version));
+  }
+  // Sections must lie inside the file, slices are checked against them
+  const auto section_fits = [size](uint64_t offset, uint64_t count,
+                                   uint64_t element_size) {
+    return offset % 8 == 0 && offset <= size &&
+           count <= (size - offset) / element_size;
+  };
+  if (header.file_size != size ||
+      !section_fits(header.terms_offset, header.term_count,
+                    sizeof(SnapshotTerm)) ||
+      !section_fits(header.words_offset, header.words_size, 1) ||
+      !section_fits(header.postings_offset, header.posting_words,
+                    sizeof(uint32_t)) ||
+      !section_fits(header.documents_offset, header.document_count,
+                    sizeof(SnapshotDocument)) ||
+      !section_fits(header.document_terms_offset, header.document_term_count,
+                    sizeof(TermFreq)) ||
+      !section_fits(header.document_positions_offset,
+                    header.document_position_count, sizeof(uint32_t))) {
+    throw std::invalid_argument("Corrupted snapshot " + path);
+  }
+  const auto *snapshot_terms =
+      reinterpret_cast<const SnapshotTerm *>(data + header.terms_offset);
+  const auto *postings =
+      reinterpret_cast<const uint32_t *>(data + header.postings_offset);
+  const auto *snapshot_documents = reinterpret_cast<const SnapshotDocument *>(
+      data + header.documents_offset);
+  const auto *document_term_freqs =
+      reinterpret_cast<const TermFreq *>(data + header.document_terms_offset);
+  const auto *document_positions_data = reinterpret_cast<const uint32_t *>(
+      data + header.document_positions_offset);
+
+  // The new index is built aside, the server stays intact if the file is bad
+  TermDictionary dictionary;
+  std::vector<TermData> terms(header.term_count);
+  // The whole snapshot becomes one segment, its postings are used in place
+  // once every block is checked
+  const int document_count = static_cast<int>(header.document_count);
+  std::vector<SegmentTerm> segment_terms;
+  for (TermId term = 0; term < header.term_count; ++term) {
+    const SnapshotTerm &snapshot_term = snapshot_terms[term];
+    const uint64_t word_end =
+        snapshot_term.word_offset + snapshot_term.word_size;
+    if (snapshot_term.word_offset > header.words_size ||
+        word_end > header.words_size ||
+        snapshot_term.first_word > header.posting_words ||
+        snapshot_term.posting_count > UINT32_MAX ||
+        !CompressedPostings::Validate(
+            postings + snapshot_term.first_word,
+            header.posting_words - snapshot_term.first_word,
+            snapshot_term.posting_count, 0, document_count) ||
+        !dictionary.Append(
+            {data + header.words_offset + snapshot_term.word_offset,
+             snapshot_term.word_size},
+            snapshot_term.references)) {
+      throw std::invalid_argument("Corrupted snapshot " + path);
+    }
+    if (snapshot_term.posting_count > 0) {
+      const CompressedPostings compressed(
+          postings + snapshot_term.first_word, snapshot_term.posting_count);
+      segment_terms.push_back(
+          {term, static_cast<uint32_t>(snapshot_term.posting_count),
+           snapshot_term.first_word, compressed.GetMaxTermFreq()});
+    }
+    SetDocumentFreq(terms[term], snapshot_term.posting_count);
+    terms[term].is_stop_word = snapshot_term.is_stop_word != 0;
+  }
+  std::vector<DocumentData> documents;
+  std::vector<DocumentTerms> document_terms;
+  std::vector<DocumentPositions> document_positions;
+  std::map<int, int> document_ordinals;
+  std::set<int> document_ids;
+  std::vector<double> inverse_word_counts;
+  // Documents with the term, index - TermId
+  std::vector<uint32_t> references(header.term_count);
+  uint64_t live_word_count = 0;
+  documents.reserve(header.document_count);
+  document_terms.reserve(header.document_count);
+  document_positions.reserve(header.document_count);
+  for (uint64_t ordinal = 0; ordinal < header.document_count; ++ordinal) {
+    const SnapshotDocument &snapshot_document = snapshot_documents[ordinal];
+    const uint64_t position_count =
+        snapshot_document.term_count + snapshot_document.word_count;
+    // Every term of a document is one of its words at least
+    if (snapshot_document.term_count > snapshot_document.word_count ||
+        snapshot_document.first_term > header.document_term_count ||
+        snapshot_document.term_count >
+            header.document_term_count - snapshot_document.first_term ||
+        snapshot_document.first_position > header.document_position_count ||
+        position_count > header.document_position_count -
+                             snapshot_document.first_position ||
+        !ValidatePositions(
+            document_positions_data + snapshot_document.first_position,
+            snapshot_document.term_count, position_count) ||
+        !ValidateDocumentTerms(
+            document_term_freqs + snapshot_document.first_term,
+            snapshot_document.term_count, header.term_count) ||
+        snapshot_document.status < 0 ||
+        snapshot_document.status > static_cast<int>(DocumentStatus::REMOVED)) {
+      throw std::invalid_argument("Corrupted snapshot " + path);
+    }
+    const auto status = static_cast<DocumentStatus>(snapshot_document.status);
+    documents.push_back(
+        {snapshot_document.id, snapshot_document.rating, status,
+         snapshot_document.word_count,
+         ComputeInverseWordCount(snapshot_document.word_count)});
+    inverse_word_counts.push_back(documents.back().inverse_word_count);
+    live_word_count += snapshot_document.word_count;
+    document_terms.push_back(
+        DocumentTerms::View(document_term_freqs + snapshot_document.first_term,
+                            snapshot_document.term_count));
+    for (const auto &[term, _] : document_terms.back()) {
+      ++references[term];
+    }
+    document_positions.push_back(DocumentPositions::View(
+        document_positions_data + snapshot_document.first_position,
+        position_count));
+    if (!document_ordinals
+             .emplace(snapshot_document.id, static_cast<int>(ordinal))
+             .second) {
+      throw std::invalid_argument("Corrupted snapshot " + path);
+    }
+    document_ids.insert(snapshot_document.id);
+  }
+  // A wrong count would free a word still in use or never free it
+  for (TermId term = 0; term < header.term_count; ++term) {
+    if (snapshot_terms[term].references !=
+        uint64_t{references[term]} + (snapshot_terms[term].is_stop_word != 0)) {
+      throw std::invalid_argument("Corrupted snapshot " + path);
+    }
+  }
+
+  std::vector<SegmentEntry> segments;
+  segments.push_back({std::make_shared<const IndexSegment>(
+      0, document_count, CowArray<SegmentTerm>(std::move(segment_terms)),
+      CowArray<uint32_t>::View(postings, header.posting_words),
+      CowArray<double>(std::move(inverse_word_counts)), snapshot)});
+
+  std::unique_lock lock(index_mutex_);
+  // Pending compaction and merges work on the old index
+  compaction_done_.wait(lock, [this] {
+    return pending_removals_.empty() && !compacting_;
+  });
+  merge_done_.wait(lock, [this] { return !merging_; });
+  dictionary_ = std::move(dictionary);
+  terms_ = std::move(terms);
+  documents_ = std::move(documents);
+  live_word_count_ = live_word_count;
+  filter_columns_.Clear();
+  for (const DocumentData &document : documents_) {
+    filter_columns_.Add(document.id, document.status, document.rating);
+  }
+  tombstones_.assign(documents_.size(), false);
+  document_terms_ = std::move(document_terms);
+  document_positions_ = std::move(document_positions);
+  document_ordinals_ = std::move(document_ordinals);
+  document_ids_ = std::move(document_ids);
+  segments_ = std::move(segments);
+  buffer_first_ordinal_ = document_count;
+  buffer_terms_.clear();
+  buffer_postings_ = 0;
+  ++stop_words_version_;
+  OnDocumentsChanged();
+  // The old mapping goes after the lists viewing it
+  snapshot_ = std::move(snapshot);
+}
+
 bool SearchServer::IsStopWord(const std::string &word) const {
-  return stop_words_.count(word) > 0;
+  return IsStopWord(std::string_view{word});
 }
 
 bool SearchServer::IsStopWord(const std::string_view word) const {
-  return stop_words_.count(word) > 0;
+  const TermId term = dictionary_.Find(word);
+  return term != TermDictionary::NO_TERM && terms_[term].is_stop_word;
+}
+
+void SearchServer::AddStopWord(const std::string_view word) {
+  if (!IsValidWord(word)) {
+    throw std::invalid_argument("Invalid symbols in the list of stop words.");
+  }
+  if (word.empty()) {
+    return;
+  }
+  const TermId term = InternTerm(word);
+  // Stop words hold a reference of their own, so they are never forgotten
+  if (!terms_[term].is_stop_word) {
+    terms_[term].is_stop_word = true;
+    dictionary_.AddReference(term);
+  }
+}
+
+TermId SearchServer::InternTerm(const std::string_view word) {
+  const TermId term = dictionary_.Intern(word);
+  if (term == terms_.size()) {
+    terms_.emplace_back();
+  }
+  return term;
+}
+
+void SearchServer::ReleaseTerms(const DocumentTerms &document_terms) {
+  for (const auto &[term, _] : document_terms) {
+    if (dictionary_.Release(term)) {
+      // Freeing the buffer of the empty posting list, the id will be reused
+      terms_[term] = TermData{};
+    }
+  }
+}
+
+SearchServer::LoggedMutation
+SearchServer::LogRemoval(const std::vector<int> &document_ids) {
+  LoggedMutation logged;
+  if (mutation_log_) {
+    logged.log = mutation_log_;
+    logged.sequence = mutation_log_->LogRemoveDocuments(document_ids);
+  }
+  return logged;
+}
+
+void SearchServer::WaitDurable(const LoggedMutation &logged) {
+  if (logged.log) {
+    logged.log->WaitDurable(logged.sequence);
+  }
+}
+
+void SearchServer::EraseDocument(const std::execution::sequenced_policy &,
+                                 int document_id) {
+  // Forgetting the id, the ordinal stays unused
+  const int ordinal = MarkRemoved(document_id);
+  // Trying to delete unexisting document.
+  if (ordinal < 0) {
+    return;
+  }
+  // Clearing the term to (ordinal, TF) index, postings in sealed segments
+  // go with the next merge
+  if (ordinal >= buffer_first_ordinal_) {
+    for (const auto &[term, _] : document_terms_[ordinal]) {
+      terms_[term].postings.Erase(ordinal);
+    }
+  }
+  ReleaseTerms(document_terms_[ordinal]);
+  // Clearing the forward index
+  document_terms_[ordinal] = {};
+  document_positions_[ordinal] = {};
+}
+
+void SearchServer::EraseDocument(const std::execution::parallel_policy &,
+                                 int document_id) {
+  // Forgetting the id, the ordinal stays unused
+  const int ordinal = MarkRemoved(document_id);
+  // Trying to delete unexisting document.
+  if (ordinal < 0) {
+    return;
+  }
+  // Clearing the term to (ordinal, TF) index, every term owns its own list
+  const DocumentTerms &document_terms = document_terms_[ordinal];
+  if (ordinal >= buffer_first_ordinal_) {
+    std::for_each(std::execution::par, document_terms.begin(),
+                  document_terms.end(), [&](const TermFreq &term_freq) {
+                    terms_[term_freq.term].postings.Erase(ordinal);
+                  });
+  }
+  // The dictionary is shared by all terms, releasing them one by one
+  ReleaseTerms(document_terms);
+  // Clearing the forward index
+  document_terms_[ordinal] = {};
+  document_positions_[ordinal] = {};
+}
+
+int SearchServer::MarkRemoved(int document_id) {
+  const auto ordinal_it = document_ordinals_.find(document_id);
+  // Unexisting or already removed document
+  if (ordinal_it == document_ordinals_.end()) {
+    return -1;
+  }
+  const int ordinal = ordinal_it->second;
+  tombstones_[ordinal] = true;
+  live_word_count_ -= documents_[ordinal].word_count;
+  filter_columns_.Remove(ordinal);
+  // Keeping document frequencies of the terms exact until the postings are
+  // erased
+  const DocumentTerms &document_terms = document_terms_[ordinal];
+  for (const auto &[term, _] : document_terms) {
+    TermData &term_data = terms_[term];
+    SetDocumentFreq(term_data, term_data.document_freq - 1);
+  }
+  if (SegmentEntry *entry = FindSegment(ordinal)) {
+    entry->removed_postings += document_terms.size();
+    merge_wake_.notify_one();
+  }
+  document_ids_.erase(document_id);
+  document_ordinals_.erase(ordinal_it);
+  OnDocumentsChanged();
+  return ordinal;
+}
+
+void SearchServer::DeferRemoval(const std::vector<int> &document_ids) {
+  for (const int document_id : document_ids) {
+    const int ordinal = MarkRemoved(document_id);
+    if (ordinal >= 0) {
+      pending_removals_.push_back(ordinal);
+    }
+  }
+  compaction_wake_.notify_one();
+}
+
+SearchServer::RemovalBatch
+SearchServer::PrepareRemoval(const std::vector<int> &document_ids) {
+  RemovalBatch batch;
+  for (const int document_id : document_ids) {
+    const int ordinal = MarkRemoved(document_id);
+    if (ordinal >= 0) {
+      batch.ordinals.push_back(ordinal);
+    }
+  }
+  batch.terms = CollectTerms(batch.ordinals);
+  return batch;
+}
+
+std::vector<TermId>
+SearchServer::CollectTerms(const std::vector<int> &ordinals) const {
+  std::vector<TermId> terms;
+  for (const int ordinal : ordinals) {
+    // Sealed segments are compacted by merging
+    if (ordinal < buffer_first_ordinal_) {
+      continue;
+    }
+    for (const auto &[term, _] : document_terms_[ordinal]) {
+      terms.push_back(term);
+    }
+  }
+  std::sort(terms.begin(), terms.end());
+  terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+  return terms;
+}
+
+void SearchServer::CompactPostings(TermId term) {
+  // Documents removed after the batch was taken go too, their own batch
+  // then finds nothing to erase
+  terms_[term].postings.EraseIf(
+      [this](int ordinal) { return tombstones_[ordinal]; });
+}
+
+void SearchServer::FinishRemoval(const RemovalBatch &batch) {
+  for (const int ordinal : batch.ordinals) {
+    ReleaseTerms(document_terms_[ordinal]);
+    document_terms_[ordinal] = {};
+    document_positions_[ordinal] = {};
+  }
+}
+
+void SearchServer::CompactInBackground() {
+  std::unique_lock lock(index_mutex_);
+  while (true) {
+    compaction_wake_.wait(lock, [this] {
+      return stop_compaction_ || !pending_removals_.empty();
+    });
+    if (stop_compaction_) {
+      return;
+    }
+    RemovalBatch batch;
+    batch.ordinals.swap(pending_removals_);
+    batch.terms = CollectTerms(batch.ordinals);
+    compacting_ = true;
+    for (size_t i = 0; i < batch.terms.size(); ++i) {
+      if (i > 0 && i % COMPACTION_BATCH_TERMS == 0) {
+        // Letting queries and modifications in between the batches
+        lock.unlock();
+        std::this_thread::yield();
+        lock.lock();
+        if (stop_compaction_) {
+          return;
+        }
+      }
+      CompactPostings(batch.terms[i]);
+    }
+    FinishRemoval(batch);
+    compacting_ = false;
+    compaction_done_.notify_all();
+  }
+}
+
+void SearchServer::AddPosting(TermId term, int ordinal, double term_freq) {
+  TermData &term_data = terms_[term];
+  if (term_data.postings.empty()) {
+    buffer_terms_.push_back(term);
+  }
+  term_data.postings.Add(ordinal, term_freq);
+  SetDocumentFreq(term_data, term_data.document_freq + 1);
+  ++buffer_postings_;
+}
+
+void SearchServer::SealWriteBufferIfFull() {
+  if (buffer_postings_ >= max_buffer_postings_) {
+    SealWriteBuffer();
+  }
+}
+
+void SearchServer::SealWriteBuffer() {
+  // A freed and reused term may be listed twice
+  std::sort(buffer_terms_.begin(), buffer_terms_.end());
+  buffer_terms_.erase(std::unique(buffer_terms_.begin(), buffer_terms_.end()),
+                      buffer_terms_.end());
+  IndexSegment::Builder builder;
+  for (const TermId term : buffer_terms_) {
+    PostingList &postings = terms_[term].postings;
+    // Soft deleted documents are left out, their compaction finds nothing
+    // to erase
+    for (const auto &[ordinal, term_freq] : postings) {
+      if (!tombstones_[ordinal]) {
+        builder.Add(term, ordinal,
+                    CountOccurrences(term_freq, documents_[ordinal]),
+                    term_freq);
+      }
+    }
+    postings = PostingList{};
+  }
+  const int last_ordinal = static_cast<int>(documents_.size());
+  std::vector<double> inverse_word_counts;
+  inverse_word_counts.reserve(last_ordinal - buffer_first_ordinal_);
+  for (int ordinal = buffer_first_ordinal_; ordinal < last_ordinal;
+       ++ordinal) {
+    inverse_word_counts.push_back(documents_[ordinal].inverse_word_count);
+  }
+  segments_.push_back({std::make_shared<const IndexSegment>(builder.Build(
+      buffer_first_ordinal_, last_ordinal, std::move(inverse_word_counts)))});
+  buffer_first_ordinal_ = last_ordinal;
+  buffer_terms_.clear();
+  buffer_postings_ = 0;
+  if (!merger_.joinable()) {
+    merger_ = std::thread([this] { MergeInBackground(); });
+  }
+  merge_wake_.notify_one();
+}
+
+SearchServer::SegmentEntry *SearchServer::FindSegment(int ordinal) {
+  if (ordinal >= buffer_first_ordinal_) {
+    return nullptr;
+  }
+  // Segments tile [0, buffer_first_ordinal_)
+  const auto it = std::upper_bound(
+      segments_.begin(), segments_.end(), ordinal,
+      [](int value, const SegmentEntry &entry) {
+        return value < entry.segment->GetFirstOrdinal();
+      });
+  return &*std::prev(it);
+}
+
+std::pair<size_t, size_t> SearchServer::PickSegmentsToMerge() const {
+  // A segment with more than a quarter of its postings removed is
+  // rewritten alone
+  for (size_t i = 0; i < segments_.size(); ++i) {
+    const SegmentEntry &entry = segments_[i];
+    if (entry.removed_postings > 0 &&
+        entry.removed_postings * 4 > entry.segment->GetPostingCount()) {
+      return {i, i + 1};
+    }
+  }
+  const auto live_postings = [this](size_t i) {
+    return segments_[i].segment->GetPostingCount() -
+           segments_[i].removed_postings;
+  };
+  // Sealed buffers are in the middle of tier 0, merged runs in the middle
+  // of the next tier, so sizes slightly off don't split the tiers
+  const auto tier = [&](size_t i) {
+    size_t tier = 0;
+    for (size_t limit = max_buffer_postings_ * 2; live_postings(i) > limit;
+         limit *= SEGMENT_MERGE_FACTOR) {
+      ++tier;
+    }
+    return tier;
+  };
+  // Oldest run of adjacent segments of one tier, so every posting is
+  // rewritten once per tier
+  size_t run_start = 0;
+  for (size_t i = 1; i < segments_.size(); ++i) {
+    if (tier(i) != tier(run_start)) {
+      run_start = i;
+    } else if (i + 1 - run_start == SEGMENT_MERGE_FACTOR) {
+      return {run_start, i + 1};
+    }
+  }
+  // Removals may leave small segments between big ones, then the smallest
+  // adjacent pair goes
+  if (segments_.size() > MAX_SEGMENTS) {
+    size_t best = 0;
+    for (size_t i = 1; i + 1 < segments_.size(); ++i) {
+      if (live_postings(i) + live_postings(i + 1) <
+          live_postings(best) + live_postings(best + 1)) {
+        best = i;
+      }
+    }
+    return {best, best + 2};
+  }
+  return {0, 0};
+}
+
+void SearchServer::MergeInBackground() {
+  std::unique_lock lock(index_mutex_);
+  while (true) {
+    std::pair<size_t, size_t> run;
+    merge_wake_.wait(lock, [&] {
+      run = PickSegmentsToMerge();
+      return stop_merging_ || run.first < run.second;
+    });
+    if (stop_merging_) {
+      return;
+    }
+    std::vector<std::shared_ptr<const IndexSegment>> segments;
+    size_t removed_postings = 0;
+    for (size_t i = run.first; i < run.second; ++i) {
+      segments.push_back(segments_[i].segment);
+      removed_postings += segments_[i].removed_postings;
+    }
+    const std::vector<bool> removed(
+        tombstones_.begin() + segments.front()->GetFirstOrdinal(),
+        tombstones_.begin() + segments.back()->GetLastOrdinal());
+    merging_ = true;
+    // Segments are immutable, queries and modifications go on while the
+    // merged one is built. Sealing only appends segments, so the run keeps
+    // its place
+    lock.unlock();
+    auto merged = std::make_shared<const IndexSegment>(
+        IndexSegment::Merge(segments, removed));
+    lock.lock();
+    // Documents removed during the merge are still in the merged segment
+    size_t removed_meanwhile = 0;
+    for (size_t i = run.first; i < run.second; ++i) {
+      removed_meanwhile += segments_[i].removed_postings;
+    }
+    removed_meanwhile -= removed_postings;
+    segments_[run.first] = {std::move(merged), removed_meanwhile};
+    segments_.erase(segments_.begin() + run.first + 1,
+                    segments_.begin() + run.second);
+    merging_ = false;
+    merge_done_.notify_all();
+  }
+}
+
+std::vector<SearchServer::TermFreq>
+SearchServer::CountTermFreqs(std::vector<TermId> terms) {
+  std::sort(terms.begin(), terms.end());
+  const double inv_word_count = 1.0 / terms.size();
+  std::vector<TermFreq> document_terms;
+  for (size_t first = 0; first < terms.size();) {
+    size_t last = first + 1;
+    while (last < terms.size() && terms[last] == terms[first]) {
+      ++last;
+    }
+    document_terms.push_back(
+        {terms[first], (last - first) * inv_word_count});
+    first = last;
+  }
+  return document_terms;
+}
+
+std::vector<uint32_t>
+SearchServer::CollectPositions(const std::vector<TermId> &words,
+                               const std::vector<TermFreq> &document_terms) {
+  const auto find_term = [&](TermId term) {
+    return static_cast<size_t>(
+        std::lower_bound(document_terms.begin(), document_terms.end(), term,
+                         [](const TermFreq &entry, TermId value) {
+                           return entry.term < value;
+                         }) -
+        document_terms.begin());
+  };
+  // Counting sort of the positions by term, the offsets go first
+  std::vector<uint32_t> positions(document_terms.size() + words.size());
+  std::vector<uint32_t> ends(document_terms.size() + 1);
+  for (const TermId term : words) {
+    ++ends[find_term(term) + 1];
+  }
+  ends[0] = static_cast<uint32_t>(document_terms.size());
+  for (size_t i = 1; i < ends.size(); ++i) {
+    ends[i] += ends[i - 1];
+  }
+  std::copy(ends.begin(), ends.end() - 1, positions.begin());
+  for (size_t position = 0; position < words.size(); ++position) {
+    positions[ends[find_term(words[position])]++] =
+        static_cast<uint32_t>(position);
+  }
+  return positions;
+}
+
+bool SearchServer::ValidatePositions(const uint32_t *positions,
+                                     size_t term_count, size_t size) {
+  // Offsets must cut the positions into groups inside the slice
+  uint32_t previous = static_cast<uint32_t>(term_count);
+  for (size_t i = 0; i < term_count; ++i) {
+    if (positions[i] < previous || positions[i] > size) {
+      return false;
+    }
+    previous = positions[i];
+  }
+  return term_count == 0 || positions[0] == term_count;
+}
+
+bool SearchServer::ValidateDocumentTerms(const TermFreq *document_terms,
+                                         size_t size, size_t term_count) {
+  for (size_t i = 0; i < size; ++i) {
+    // Negated, so NaN fails too
+    if (document_terms[i].term >= term_count ||
+        (i > 0 && document_terms[i].term <= document_terms[i - 1].term) ||
+        !(document_terms[i].term_freq > 0 &&
+          document_terms[i].term_freq <= 1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+double SearchServer::ComputeInverseWordCount(size_t word_count) {
+  return word_count > 0 ? 1.0 / word_count : 0;
+}
+
+uint32_t SearchServer::CountOccurrences(double term_freq,
+                                        const DocumentData &document) {
+  return static_cast<uint32_t>(std::lround(term_freq * document.word_count));
+}
+
+void SearchServer::CheckNewDocumentId(int document_id) const {
+  if (document_ordinals_.count(document_id) > 0) {
+    throw std::invalid_argument(
+        "Document with the given ID is already existing.");
+  }
+}
+
+void SearchServer::CheckNewDocumentIds(
+    const std::vector<NewDocument> &documents) const {
+  std::vector<int> ids;
+  ids.reserve(documents.size());
+  for (const NewDocument &document : documents) {
+    if (document.id < 0) {
+      throw std::invalid_argument("Invalid document ID.");
+    }
+    CheckNewDocumentId(document.id);
+    ids.push_back(document.id);
+  }
+  std::sort(ids.begin(), ids.end());
+  if (std::adjacent_find(ids.begin(), ids.end()) != ids.end()) {
+    throw std::invalid_argument("Document ID is repeated in the batch.");
+  }
+}
+
+void SearchServer::TokenizeDocuments(const std::vector<NewDocument> &documents,
+                                     PartialIndex &partial) const {
+  try {
+    std::unordered_map<std::string_view, TermId> local_ids;
+    for (size_t i = partial.first_document; i < partial.last_document; ++i) {
+      const std::vector<std::string_view> words =
+          SplitIntoWordsNoStop(documents[i].text);
+      std::vector<TermId> terms;
+      terms.reserve(words.size());
+      for (const std::string_view word : words) {
+        const auto [it, inserted] = local_ids.emplace(
+            word, static_cast<TermId>(partial.words.size()));
+        if (inserted) {
+          partial.words.push_back(word);
+          partial.postings.emplace_back();
+        }
+        terms.push_back(it->second);
+      }
+      std::vector<TermFreq> document_terms = CountTermFreqs(terms);
+      for (const auto &[term, term_freq] : document_terms) {
+        partial.postings[term].push_back({static_cast<int>(i), term_freq});
+      }
+      partial.document_terms.push_back(std::move(document_terms));
+      partial.document_words.push_back(std::move(terms));
+      partial.word_counts.push_back(static_cast<uint32_t>(words.size()));
+    }
+  } catch (...) {
+    partial.error = std::current_exception();
+  }
+}
+
+void SearchServer::MergePartialIndexes(
+    const std::vector<NewDocument> &documents,
+    std::vector<PartialIndex> &partials, bool parallel) {
+  const auto for_each_index = [parallel](size_t count, const auto &func) {
+    std::vector<size_t> indexes(count);
+    std::iota(indexes.begin(), indexes.end(), 0);
+    if (parallel) {
+      std::for_each(std::execution::par, indexes.begin(), indexes.end(), func);
+    } else {
+      std::for_each(indexes.begin(), indexes.end(), func);
+    }
+  };
+
+  // Every word of a slice is looked up in the dictionary once. Posting
+  // lists of the batch are grouped by term, in slice order
+  std::vector<std::vector<TermId>> global_terms(partials.size());
+  std::vector<std::pair<TermId, const std::vector<Posting> *>> term_postings;
+  for (size_t p = 0; p < partials.size(); ++p) {
+    const PartialIndex &partial = partials[p];
+    for (size_t local = 0; local < partial.words.size(); ++local) {
+      const TermId term = InternTerm(partial.words[local]);
+      const size_t posting_count = partial.postings[local].size();
+      dictionary_.AddReference(term, static_cast<uint32_t>(posting_count));
+      TermData &term_data = terms_[term];
+      if (term_data.postings.empty()) {
+        buffer_terms_.push_back(term);
+      }
+      SetDocumentFreq(term_data, term_data.document_freq + posting_count);
+      buffer_postings_ += posting_count;
+      global_terms[p].push_back(term);
+      term_postings.emplace_back(term, &partial.postings[local]);
+    }
+  }
+  std::stable_sort(term_postings.begin(), term_postings.end(),
+                   [](const auto &lhs, const auto &rhs) {
+                     return lhs.first < rhs.first;
+                   });
+  std::vector<size_t> group_starts;
+  for (size_t i = 0; i < term_postings.size(); ++i) {
+    if (i == 0 || term_postings[i].first != term_postings[i - 1].first) {
+      group_starts.push_back(i);
+    }
+  }
+  group_starts.push_back(term_postings.size());
+
+  const int first_ordinal = static_cast<int>(documents_.size());
+  // Every term owns its own list, ordinals only grow, so postings are
+  // appended at the end
+  for_each_index(group_starts.size() - 1, [&](size_t group) {
+    PostingList &postings = terms_[term_postings[group_starts[group]].first]
+                                .postings;
+    for (size_t i = group_starts[group]; i < group_starts[group + 1]; ++i) {
+      for (const auto &[index, term_freq] : *term_postings[i].second) {
+        postings.Add(first_ordinal + index, term_freq);
+      }
+    }
+  });
+  // Forward index gets the global ids
+  for_each_index(partials.size(), [&](size_t p) {
+    for (std::vector<TermFreq> &document_terms : partials[p].document_terms) {
+      for (TermFreq &term_freq : document_terms) {
+        term_freq.term = global_terms[p][term_freq.term];
+      }
+      std::sort(document_terms.begin(), document_terms.end(),
+                [](const TermFreq &lhs, const TermFreq &rhs) {
+                  return lhs.term < rhs.term;
+                });
+    }
+    PartialIndex &partial = partials[p];
+    for (size_t i = 0; i < partial.document_words.size(); ++i) {
+      for (TermId &term : partial.document_words[i]) {
+        term = global_terms[p][term];
+      }
+      partial.document_positions.push_back(CollectPositions(
+          partial.document_words[i], partial.document_terms[i]));
+    }
+  });
+
+  for (PartialIndex &partial : partials) {
+    for (size_t i = partial.first_document; i < partial.last_document; ++i) {
+      const NewDocument &document = documents[i];
+      document_ids_.insert(document.id);
+      document_ordinals_.emplace(document.id,
+                                 static_cast<int>(documents_.size()));
+      const uint32_t word_count =
+          partial.word_counts[i - partial.first_document];
+      documents_.push_back(DocumentData{
+          document.id, ComputeAverageRating(document.ratings), document.status,
+          word_count, ComputeInverseWordCount(word_count)});
+      filter_columns_.Add(document.id, document.status,
+                          documents_.back().rating);
+      live_word_count_ += word_count;
+      tombstones_.push_back(false);
+      document_terms_.emplace_back(std::move(
+          partial.document_terms[i - partial.first_document]));
+      document_positions_.emplace_back(std::move(
+          partial.document_positions[i - partial.first_document]));
+    }
+  }
+  OnDocumentsChanged();
+  SealWriteBufferIfFull();
+}
+
+void SearchServer::AddDocumentsInSlices(
+    const std::vector<NewDocument> &documents, size_t slice_count) {
+  std::vector<PartialIndex> partials;
+  const auto tokenize = [&]() {
+    partials.assign(slice_count, PartialIndex{});
+    for (size_t p = 0; p < slice_count; ++p) {
+      partials[p].first_document = documents.size() * p / slice_count;
+      partials[p].last_document = documents.size() * (p + 1) / slice_count;
+    }
+    std::for_each(std::execution::par, partials.begin(), partials.end(),
+                  [&](PartialIndex &partial) {
+                    TokenizeDocuments(documents, partial);
+                  });
+    for (const PartialIndex &partial : partials) {
+      if (partial.error) {
+        std::rethrow_exception(partial.error);
+      }
+    }
+  };
+  uint64_t stop_words_version;
+  {
+    // Tokenising only reads the stop words, queries may go on
+    std::shared_lock lock(index_mutex_);
+    CheckNewDocumentIds(documents);
+    tokenize();
+    stop_words_version = stop_words_version_;
+  }
+
+  std::unique_lock lock(index_mutex_);
+  // Another thread might have added some of the ids meanwhile
+  CheckNewDocumentIds(documents);
+  if (stop_words_version != stop_words_version_) {
+    tokenize();
+  }
+  MergePartialIndexes(documents, partials, slice_count > 1);
+  LoggedMutation logged;
+  if (mutation_log_) {
+    logged.log = mutation_log_;
+    for (const NewDocument &document : documents) {
+      logged.sequence = mutation_log_->LogAddDocument(
+          document.id, document.text, document.status, document.ratings);
+    }
+  }
+  lock.unlock();
+  WaitDurable(logged);
 }
 
 bool SearchServer::IsValidWord(const std::string &word) {
-  // A valid word must not contain special characters
-  return std::none_of(word.begin(), word.end(),
-                      [](char c) { return c >= '\0' && c < ' '; });
+  return IsValidWord(std::string_view{word});
 }
 
 bool SearchServer::IsValidWord(const std::string_view word) {
   // A valid word must not contain special characters
-  return std::none_of(word.begin(), word.end(),
-                      [](char c) { return c >= '\0' && c < ' '; });
+  return !HasSpecialCharacters(word);
 }
 
 // Input: line of words, splitting them to vector, ignoring stop_words
 std::vector<std::string>
 SearchServer::SplitIntoWordsNoStop(const std::string &text) const {
   std::vector<std::string> result;
-  for (const std::string &word : SplitIntoWords(text)) {
-    if (!IsValidWord(word)) {
-      throw std::invalid_argument(
-          "Invalid query. Special symbols in the query.");
-    }
-    if (!IsStopWord(word)) {
-      result.push_back(word);
+  for (const std::string_view word :
+       SplitIntoWordsNoStop(std::string_view{text})) {
+    if (!word.empty()) {
+      result.emplace_back(word);
     }
   }
   return result;
@@ -276,23 +1399,16 @@ SearchServer::SplitIntoWordsNoStop(const std::string &text) const {
 
 std::vector<std::string_view>
 SearchServer::SplitIntoWordsNoStop(std::string_view str) const {
+  // Words are split and checked for special characters in one pass
   std::vector<std::string_view> result;
-  while (true) {
-    size_t space = str.find(' ');
-    const std::string_view &word = str.substr(0, space);
-    if (!IsValidWord(word)) {
-      throw std::invalid_argument(
-          "Invalid query. Special symbols in the query.");
-    }
-    if (!IsStopWord(word)) {
-      result.push_back(word);
-    }
-    if (space == str.npos) {
-      break;
-    } else {
-      str.remove_prefix(space + 1);
-    }
+  if (!TokenizeText(str, result)) {
+    throw std::invalid_argument("Invalid query. Special symbols in the query.");
   }
+  result.erase(std::remove_if(result.begin(), result.end(),
+                              [this](const std::string_view word) {
+                                return IsStopWord(word);
+                              }),
+               result.end());
   return result;
 }
 
@@ -306,12 +1422,25 @@ int SearchServer::ComputeAverageRating(const std::vector<int> &ratings) {
 }
 
 // Input: word, if first character is '-', remove it, add is_minus flag to the
-// word
+// word; '+' marks a required word the same way
 SearchServer::QueryWord
 SearchServer::ParseQueryWord(std::string_view word) const {
   bool is_minus = false;
+  bool is_required = false;
   if (word.empty()) {
-    return {word, is_minus};
+    return {word, is_minus, is_required};
+  }
+  if (word[0] == '+') {
+    is_required = true;
+    word = word.substr(1);
+    if (word.empty()) {
+      throw std::invalid_argument("Invalid query. Empty required word.");
+    }
+    if (word[0] == '-' || word[0] == '+') {
+      throw std::invalid_argument(
+          "Invalid query. Required word can't be a minus word.");
+    }
+    return {word, is_minus, is_required};
   }
   // Word shouldn't be empty
   if (word[0] == '-') {
@@ -325,16 +1454,289 @@ SearchServer::ParseQueryWord(std::string_view word) const {
     throw std::invalid_argument(
         "Invalid query. Double minus in the minus word.");
   }
-  if (!IsValidWord(word)) {
-    throw std::invalid_argument("Invalid query. Special symbols in the query.");
+  // Special characters were rejected when the query was split
+  return {word, is_minus, is_required};
+}
+
+SearchServer::Query
+SearchServer::ParseQuery(const std::string_view text) const {
+  Query result;
+  bool in_phrase = false;
+  std::vector<TermId> phrase;
+  // Words required by '+' or by a phrase, the unknown ones match nothing
+  const auto add_required = [&result](TermId term) {
+    if (term == TermDictionary::NO_TERM) {
+      result.matches_nothing = true;
+      return;
+    }
+    result.plus_terms.push_back(term);
+    result.required_terms.push_back(term);
+  };
+  for (std::string_view word : SplitIntoWordsNoStop(text)) {
+    if (!in_phrase && !word.empty() && word[0] == '"') {
+      in_phrase = true;
+      word.remove_prefix(1);
+    }
+    if (in_phrase) {
+      const bool closes_phrase = !word.empty() && word.back() == '"';
+      if (closes_phrase) {
+        word.remove_suffix(1);
+      }
+      if (!word.empty() && (word[0] == '-' || word[0] == '+')) {
+        throw std::invalid_argument(
+            "Invalid query. Minus or required word in a phrase.");
+      }
+      // Stop words have no positions, the phrase skips them as documents do
+      if (!word.empty() && !IsStopWord(word)) {
+        phrase.push_back(dictionary_.Find(word));
+        add_required(phrase.back());
+      }
+      if (closes_phrase) {
+        if (phrase.size() > 1) {
+          result.phrases.push_back(std::move(phrase));
+        }
+        phrase.clear();
+        in_phrase = false;
+      }
+      continue;
+    }
+    const QueryWord query_word = ParseQueryWord(word);
+    if (query_word.is_required) {
+      if (!IsStopWord(query_word.data)) {
+        add_required(dictionary_.Find(query_word.data));
+      }
+      continue;
+    }
+    const TermId term = dictionary_.Find(query_word.data);
+    if (term == TermDictionary::NO_TERM) {
+      continue;
+    }
+    if (query_word.is_minus) {
+      result.minus_terms.push_back(term);
+    } else {
+      result.plus_terms.push_back(term);
+    }
+  }
+  if (in_phrase) {
+    throw std::invalid_argument("Invalid query. Unclosed phrase.");
+  }
+  // Erasing duplicates from plus, minus and required terms
+  for (std::vector<TermId> *terms :
+       {&result.plus_terms, &result.minus_terms, &result.required_terms}) {
+    std::sort(terms->begin(), terms->end());
+    terms->erase(std::unique(terms->begin(), terms->end()), terms->end());
+  }
+  return result;
+}
+
+std::vector<SearchServer::SegmentPostings>
+SearchServer::ResolveQuery(const Query &query,
+                           const std::vector<double> &word_weights) const {
+  std::vector<std::pair<TermId, double>> plus_terms;
+  for (size_t i = 0; i < query.plus_terms.size(); ++i) {
+    if (terms_[query.plus_terms[i]].document_freq > 0) {
+      plus_terms.emplace_back(query.plus_terms[i], word_weights[i]);
+    }
+  }
+  std::vector<SegmentPostings> result;
+  if (plus_terms.empty() || query.matches_nothing) {
+    return result;
   }
-  return {word, is_minus};
+  // Postings of every segment and then of the write buffer
+  const auto add_segment = [&](int first_ordinal, int last_ordinal,
+                               const auto &find) {
+    SegmentPostings postings{first_ordinal, last_ordinal, {}, {}, {}, {},
+                             &query.phrases};
+    for (const TermId term : query.required_terms) {
+      const PostingRange range = find(term);
+      if (range.empty()) {
+        return;
+      }
+      postings.required.push_back(range);
+    }
+    if (!postings.required.empty()) {
+      std::sort(postings.required.begin(), postings.required.end(),
+                [](const PostingRange &lhs, const PostingRange &rhs) {
+                  return lhs.size() < rhs.size();
+                });
+      postings.plus_terms = plus_terms;
+    }
+    for (const auto &[term, word_weight] : plus_terms) {
+      const PostingRange range = find(term);
+      if (!range.empty()) {
+        postings.plus.emplace_back(range, word_weight);
+      }
+    }
+    if (postings.plus.empty()) {
+      return;
+    }
+    for (const TermId term : query.minus_terms) {
+      const PostingRange range = find(term);
+      if (!range.empty()) {
+        postings.minus.push_back(range);
+      }
+    }
+    result.push_back(std::move(postings));
+  };
+  for (const SegmentEntry &entry : segments_) {
+    const IndexSegment &segment = *entry.segment;
+    add_segment(segment.GetFirstOrdinal(), segment.GetLastOrdinal(),
+                [&segment](TermId term) { return segment.Find(term); });
+  }
+  add_segment(buffer_first_ordinal_, static_cast<int>(documents_.size()),
+              [this](TermId term) {
+                return PostingRange(terms_[term].postings);
+              });
+  return result;
+}
+
+std::vector<SearchServer::ScoringChunk> SearchServer::SplitIntoScoringChunks(
+    const std::vector<SegmentPostings> &segments) const {
+  size_t total_postings = 0;
+  for (const SegmentPostings &postings : segments) {
+    for (const auto &[range, _] : postings.plus) {
+      total_postings += range.size();
+    }
+    for (const PostingRange &range : postings.minus) {
+      total_postings += range.size();
+    }
+  }
+  const size_t chunk_postings = std::max(
+      MIN_SCORING_CHUNK_POSTINGS,
+      total_postings /
+          (scoring_pool_->GetConcurrency() * SCORING_CHUNKS_PER_THREAD));
+
+  // Small queries are scored by the calling thread
+  if (total_postings <= chunk_postings) {
+    return {{0, 0, 0}};
+  }
+
+  // Every sample stands for sample_step postings of its list, or a whole
+  // block of compressed postings. Cutting the sorted samples by accumulated
+  // weight balances the chunks whatever the lengths of the lists are
+  const size_t sample_step = std::max<size_t>(chunk_postings / 8, 1);
+  std::vector<ScoringChunk> chunks;
+  for (size_t i = 0; i < segments.size(); ++i) {
+    const SegmentPostings &postings = segments[i];
+    std::vector<PostingRange> ranges(postings.minus);
+    for (const auto &[range, _] : postings.plus) {
+      ranges.push_back(range);
+    }
+    std::vector<std::pair<int, size_t>> samples; // (ordinal, weight)
+    for (const PostingRange &range : ranges) {
+      range.ForEachSample(sample_step, [&](int ordinal, size_t weight) {
+        samples.emplace_back(ordinal, weight);
+      });
+    }
+    std::sort(samples.begin(), samples.end());
+
+    int chunk_start = postings.first_ordinal;
+    size_t chunk_weight = 0;
+    for (const auto &[ordinal, weight] : samples) {
+      chunk_weight += weight;
+      if (chunk_weight >= chunk_postings && ordinal > chunk_start) {
+        chunks.push_back({i, chunk_start, ordinal});
+        chunk_start = ordinal;
+        chunk_weight = 0;
+      }
+    }
+    chunks.push_back({i, chunk_start, postings.last_ordinal});
+  }
+  return chunks;
 }
 
-// Calculating IDF as log(number of documents / number of documents with word
-// encountered in them Input: word we are calculating IDF for
-double SearchServer::ComputeWordInverseDocumentFreq(
-    const std::string_view word) const {
-  return log(GetDocumentCount() * 1.0 /
-             word_to_document_freqs_.at(word).size());
-}
\ No newline at end of file
+CorpusStats SearchServer::GetCorpusStats() const {
+  const size_t document_count = document_ordinals_.size();
+  return {document_count, log_document_count_,
+          document_count > 0
+              ? static_cast<double>(live_word_count_) / document_count
+              : 0};
+}
+
+void SearchServer::SetDocumentFreq(TermData &term_data, size_t document_freq) {
+  term_data.document_freq = document_freq;
+  term_data.log_document_freq = log(static_cast<double>(document_freq));
+}
+
+void SearchServer::OnDocumentsChanged() {
+  ++index_epoch_;
+  log_document_count_ = log(static_cast<double>(document_ordinals_.size()));
+}
+
+bool SearchServer::DocumentHasTerm(TermId term, int ordinal) const {
+  const DocumentTerms &document_terms = document_terms_[ordinal];
+  const auto it = std::lower_bound(
+      document_terms.begin(), document_terms.end(), term,
+      [](const TermFreq &term_freq, TermId value) {
+        return term_freq.term < value;
+      });
+  return it != document_terms.end() && it->term == term;
+}
+
+double SearchServer::GetTermFreq(TermId term, int ordinal) const {
+  const DocumentTerms &document_terms = document_terms_[ordinal];
+  const auto it = std::lower_bound(
+      document_terms.begin(), document_terms.end(), term,
+      [](const TermFreq &term_freq, TermId value) {
+        return term_freq.term < value;
+      });
+  return it != document_terms.end() && it->term == term ? it->term_freq : 0;
+}
+
+bool SearchServer::DocumentHasPhrase(const std::vector<TermId> &phrase,
+                                     int ordinal) const {
+  const DocumentTerms &document_terms = document_terms_[ordinal];
+  const DocumentPositions &positions = document_positions_[ordinal];
+  // Positions of every phrase word, the first one drives the search
+  std::vector<std::pair<const uint32_t *, const uint32_t *>> word_positions;
+  for (const TermId term : phrase) {
+    const auto it = std::lower_bound(
+        document_terms.begin(), document_terms.end(), term,
+        [](const TermFreq &term_freq, TermId value) {
+          return term_freq.term < value;
+        });
+    if (it == document_terms.end() || it->term != term) {
+      return false;
+    }
+    const size_t i = it - document_terms.begin();
+    const size_t last =
+        i + 1 < document_terms.size() ? positions[i + 1] : positions.size();
+    word_positions.emplace_back(positions.begin() + positions[i],
+                                positions.begin() + last);
+  }
+  const auto &[first, last] = word_positions.front();
+  return std::any_of(first, last, [&](uint32_t position) {
+    for (size_t k = 1; k < word_positions.size(); ++k) {
+      if (!std::binary_search(word_positions[k].first,
+                              word_positions[k].second, position + k)) {
+        return false;
+      }
+    }
+    return true;
+  });
+}
+
+bool SearchServer::DocumentHasRequired(const Query &query, int ordinal) const {
+  if (query.matches_nothing) {
+    return false;
+  }
+  return std::all_of(query.required_terms.begin(), query.required_terms.end(),
+                     [&](TermId term) {
+                       return DocumentHasTerm(term, ordinal);
+                     }) &&
+         std::all_of(query.phrases.begin(), query.phrases.end(),
+                     [&](const std::vector<TermId> &phrase) {
+                       return DocumentHasPhrase(phrase, ordinal);
+                     });
+}
+
+std::vector<std::string_view>
+SearchServer::GetSortedWords(const std::vector<TermId> &terms) const {
+  std::vector<std::string_view> words;
+  words.reserve(terms.size());
+  for (const TermId term : terms) {
+    words.push_back(dictionary_.GetWord(term));
+  }
+  std::sort(words.begin(), words.end());
+  return words;
+}
@@ -2,75 +2,211 @@
 
 #include <algorithm> //std::sort
 #include <cmath>     //natural log, DBL_EPSILON
-#include <deque>
+#include <condition_variable>
+#include <exception>
 #include <execution>
 #include <float.h>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <numeric> //std::accumulate
 #include <set>
+#include <shared_mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
-#include "concurrent_map.h"
+#include "cow_array.h"
 #include "document.h"
+#include "document_filter.h"
+#include "index_segment.h"
+#include "mapped_file.h"
+#include "mutation_log.h"
+#include "posting_list.h"
 #include "read_input_functions.h"
+#include "relevance_accumulator.h"
+#include "result_cache.h"
+#include "scorers.h"
 #include "string_processing.h"
+#include "term_dictionary.h"
+#include "top_documents.h"
+#include "work_stealing_pool.h"
 #ifndef _MAX_RESULT_DOCUMENT_COUNT_
 #define _MAX_RESULT_DOCUMENT_COUNT_
 const int MAX_RESULT_DOCUMENT_COUNT = 5; // Used in the FindTopDocuments
 #endif                                   // !_MAX_RESULT_DOCUMENT_COUNT_
 
-// static const double DBL_EPSILON = 2.2e-016; //In the latter standarts this
-// variable is defined in the <cmath>
-
-// This function is used to check if two doubles are equal within a margine of
-// an _DBL_EPSILON = 2.2e-016
-bool AlmostEqualRelative(double A, double B, double maxRelDiff = DBL_EPSILON);
-
+// Every method may be called from several threads at once: queries run
+// concurrently with each other and wait only while a modification updates
+// the index
 class SearchServer {
 public:
   explicit SearchServer(const std::string &text);
   explicit SearchServer(const std::string_view text);
   template <typename ContainerT>
   explicit SearchServer(const ContainerT &container);
+  // Stops the background compaction and segment merging
+  ~SearchServer();
 
   // Input: document id, line of words we are planning to add to the document,
   // document status(ACTUAL, IRRELEVANT, BANNED, REMODED), vector of ratings
   void AddDocument(int document_id, const std::string_view document,
                    DocumentStatus status, const std::vector<int> &ratings);
+  // Adds the documents as one batch: either all of them or, if any
+  // document is invalid, none. The parallel version tokenises slices of the
+  // batch into partial indexes concurrently and then merges them into the
+  // index, every posting list is appended once per slice
+  void AddDocuments(const std::vector<NewDocument> &documents);
+  void AddDocuments(const std::execution::sequenced_policy &,
+                    const std::vector<NewDocument> &documents);
+  void AddDocuments(const std::execution::parallel_policy &,
+                    const std::vector<NewDocument> &documents);
   void RemoveDocument(int document_id);
   void RemoveDocument(const std::execution::sequenced_policy &,
                       int document_id);
   void RemoveDocument(const std::execution::parallel_policy &, int document_id);
+  // In soft delete mode removals only mark documents in a bitmap the queries
+  // check, postings are erased later by a background thread in small
+  // batches, so neither removals nor queries wait for posting lists to be
+  // rewritten. Turning the mode off doesn't drop pending compactions
+  void SetSoftDelete(bool enabled);
+  // Blocks until postings of all soft deleted documents are erased
+  void WaitForCompaction();
+  // Removes the documents as one batch: they are marked removed first and
+  // every affected posting list is then compacted in a single pass, instead
+  // of one erase per document. Unknown and repeated ids are ignored
+  void RemoveDocuments(const std::vector<int> &document_ids);
+  void RemoveDocuments(const std::execution::sequenced_policy &,
+                       const std::vector<int> &document_ids);
+  void RemoveDocuments(const std::execution::parallel_policy &,
+                       const std::vector<int> &document_ids);
 
   // Input: query of words (line) we are searching for, predicate, results are
-  // saved in result Predicate is used to filter documents in FindAllDocuments
-  template <typename PredicateT>
+  // saved in result Predicate is used to filter documents in FindAllDocuments.
+  // Scorer is the ranking model (scorers.h), FindTopDocuments<Bm25Scorer>
+  // ranks by BM25 instead of TF-IDF
+  template <typename Scorer = TfIdfScorer, typename PredicateT>
   std::vector<Document> FindTopDocuments(const std::string_view raw_query,
                                          PredicateT predicate) const;
+  template <typename Scorer = TfIdfScorer>
   std::vector<Document> FindTopDocuments(const std::string_view raw_query,
                                          DocumentStatus status) const;
+  template <typename Scorer = TfIdfScorer>
+  std::vector<Document> FindTopDocuments(const std::string_view raw_query,
+                                         const DocumentFilter &filter) const;
+  template <typename Scorer = TfIdfScorer>
   std::vector<Document>
   FindTopDocuments(const std::string_view raw_query) const;
 
-  template <typename ExecutionPolicy, typename PredicateT>
+  template <typename Scorer = TfIdfScorer, typename ExecutionPolicy,
+            typename PredicateT>
   std::vector<Document> FindTopDocuments(ExecutionPolicy &&,
                                          const std::string_view raw_query,
                                          PredicateT predicate) const;
-  template <typename ExecutionPolicy>
+  template <typename Scorer = TfIdfScorer, typename ExecutionPolicy>
   std::vector<Document> FindTopDocuments(ExecutionPolicy &&,
                                          const std::string_view raw_query,
                                          DocumentStatus status) const;
-  template <typename ExecutionPolicy>
+  template <typename Scorer = TfIdfScorer, typename ExecutionPolicy>
+  std::vector<Document> FindTopDocuments(ExecutionPolicy &&,
+                                         const std::string_view raw_query,
+                                         const DocumentFilter &filter) const;
+  template <typename Scorer = TfIdfScorer, typename ExecutionPolicy>
   std::vector<Document>
   FindTopDocuments(ExecutionPolicy &&, const std::string_view raw_query) const;
+  // Returns up to result_count best documents
+  template <typename Scorer = TfIdfScorer, typename ExecutionPolicy,
+            typename PredicateT>
+  std::vector<Document>
+  FindTopDocuments(ExecutionPolicy &&, const std::string_view raw_query,
+                   PredicateT predicate, size_t result_count) const;
+  template <typename Scorer = TfIdfScorer, typename ExecutionPolicy>
+  std::vector<Document>
+  FindTopDocuments(ExecutionPolicy &&, const std::string_view raw_query,
+                   DocumentStatus status, size_t result_count) const;
+  // Documents are filtered by the bitmaps and columns the server keeps
+  // instead of a predicate call per posting, status queries are filtered
+  // the same way
+  template <typename Scorer = TfIdfScorer, typename ExecutionPolicy>
+  std::vector<Document>
+  FindTopDocuments(ExecutionPolicy &&, const std::string_view raw_query,
+                   const DocumentFilter &filter, size_t result_count) const;
+  // Returns the page of up to limit documents that follow the offset best
+  // ones. Only the best offset + limit documents are selected, so deeper
+  // pages cost more, but never a full sort of every match
+  template <typename Scorer = TfIdfScorer, typename ExecutionPolicy,
+            typename PredicateT>
+  std::vector<Document>
+  FindTopDocuments(ExecutionPolicy &&, const std::string_view raw_query,
+                   PredicateT predicate, size_t offset, size_t limit) const;
+  template <typename Scorer = TfIdfScorer, typename ExecutionPolicy>
+  std::vector<Document>
+  FindTopDocuments(ExecutionPolicy &&, const std::string_view raw_query,
+                   DocumentStatus status, size_t offset, size_t limit) const;
+  template <typename Scorer = TfIdfScorer, typename ExecutionPolicy>
+  std::vector<Document>
+  FindTopDocuments(ExecutionPolicy &&, const std::string_view raw_query,
+                   const DocumentFilter &filter, size_t offset,
+                   size_t limit) const;
+
+  // Results of FindTopDocuments by status or filter are cached for up to
+  // max_entries queries, keyed on the parsed query, the scorer, the filter
+  // and the number of results. Any modification of the index makes every cached
+  // result stale. Queries with a predicate of their own are never cached.
+  // 0 turns the cache off, which is the default
+  void SetResultCacheSize(size_t max_entries);
+  ResultCache::Stats GetResultCacheStats() const;
+
+  // Queries without required words are scored document by document,
+  // skipping documents whose upper bound of relevance can't enter the
+  // results (MaxScore with the block bounds of the postings). Turning it
+  // off scores every document of the plus words, the results are the same
+  void SetDynamicPruning(bool enabled);
+
+  // Number of threads scoring one parallel FindTopDocuments, the calling
+  // thread included. By default the server uses a pool shared with other
+  // servers that has a thread per hardware thread
+  void SetScoringConcurrency(size_t concurrency);
+
+  // New postings go to a write buffer, once it holds max_postings of them
+  // the buffer is sealed into an immutable segment. A background thread
+  // merges runs of similar sized segments and rewrites segments with many
+  // removed documents, queries score every segment separately
+  void SetWriteBufferSize(size_t max_postings);
+  // Blocks until no segments are waiting to be merged
+  void WaitForMerges();
+  size_t GetSegmentCount() const;
 
   int GetDocumentCount() const;
-  const std::map<std::string_view, double> &
-  GetWordFrequencies(int document_id) const;
-  std::set<int>::const_iterator begin();
-  std::set<int>::const_iterator end();
+  // Bytes allocated for the postings of the inverted index
+  size_t GetPostingsMemoryUsage() const;
+
+  // Memory held by the index versus memory its live contents need. Words of
+  // removed documents are freed as soon as no document has them, so the
+  // difference is capacity slack and freed slots waiting for reuse
+  struct StorageStats {
+    size_t word_bytes_held = 0;
+    size_t word_bytes_live = 0;
+    size_t posting_bytes_held = 0;
+    size_t posting_bytes_live = 0;
+    size_t forward_index_bytes_held = 0;
+    size_t forward_index_bytes_live = 0;
+    // Size of the loaded snapshot, memory of the mapping isn't held above
+    size_t snapshot_bytes_mapped = 0;
+  };
+  StorageStats GetStorageStats() const;
+  // Returns words of the document and their TFs. The words stay valid while
+  // any document containing them is in the index
+  std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
+  // Ids of the document words, sorted. Ids are dense and stable while the
+  // words are in the index, but mean nothing outside this server
+  std::vector<TermId> GetDocumentTerms(int document_id) const;
+  // Ids of the documents, copied under the lock
+  std::vector<int> GetDocumentIds() const;
+  // Iterating the ids is not safe while another thread modifies the
+  // server, use GetDocumentIds then
+  std::set<int>::const_iterator begin() const;
+  std::set<int>::const_iterator end() const;
 
   // Input: raw query (line of words), document id
   // Output: vector of matched words, document status
@@ -83,34 +219,274 @@ public:
   MatchDocument(const std::execution::parallel_policy &,
                 const std::string_view raw_query, int document_id) const;
 
+  // Writes the index into a versioned binary file (snapshot_format.h),
+  // replacing the file atomically. Removed documents are left out. The
+  // attached mutation log is truncated, the snapshot has all its records.
+  // Throws std::runtime_error if the file can't be written
+  void SaveSnapshot(const std::string &path) const;
+  // Replaces contents of the server, stop words included, with a snapshot.
+  // The file is mapped and posting lists and the forward index are used in
+  // place, a list is copied only when it is modified. Throws
+  // std::runtime_error if the file can't be read and std::invalid_argument
+  // if it isn't a snapshot of a supported version
+  void LoadSnapshot(const std::string &path);
+  // Every AddDocument and RemoveDocument(s) is appended to the log before
+  // it returns and, depending on the durability of the log, waits until
+  // the record is synced. nullptr detaches the log. A restart loads the last
+  // snapshot and replays the log with MutationLog::Replay
+  void SetMutationLog(std::shared_ptr<MutationLog> mutation_log);
+
 private:
   struct DocumentData {
+    int id;
     int rating;
     DocumentStatus status;
+    // Words of the document without stop words, repeats included. TF of a
+    // word is the number of its occurrences times 1 / word_count
+    uint32_t word_count;
+    // 1 / word_count, the length norm of scorers, computed once when the
+    // document is added
+    double inverse_word_count;
   };
 
   struct QueryWord {
     std::string_view data;
     bool is_minus;
+    bool is_required;
   };
 
+  // Query words known to the index, sorted and without duplicates. Required
+  // words and the words of phrases are plus words too
   struct Query {
-    std::vector<std::string_view> plus_words;
-    std::vector<std::string_view> minus_words;
+    std::vector<TermId> plus_terms;
+    std::vector<TermId> minus_terms;
+    std::vector<TermId> required_terms;
+    // Words of every phrase in order, phrases of one word are just required
+    std::vector<std::vector<TermId>> phrases;
+    // A required word the index doesn't know
+    bool matches_nothing = false;
+  };
+
+  struct TermData {
+    // (ordinal, TF) of the documents in the write buffer
+    PostingList postings;
+    // Live documents having the term in all segments and the buffer
+    size_t document_freq = 0;
+    // log(document_freq), refreshed with every change of document_freq, so
+    // IDF costs a subtraction per query word
+    double log_document_freq = 0;
+    bool is_stop_word = false;
+  };
+
+  struct SegmentEntry {
+    std::shared_ptr<const IndexSegment> segment;
+    // Postings of removed documents still in the segment
+    size_t removed_postings = 0;
+  };
+
+  // Term of the document and its TF
+  struct TermFreq {
+    TermId term;
+    double term_freq;
+  };
+  // Terms of one document sorted by term, may live in a mapped snapshot
+  using DocumentTerms = CowArray<TermFreq>;
+  // Positions of the words of one document (stop words don't count),
+  // grouped by term in the order of its DocumentTerms. The first
+  // term_count elements are offsets of the groups from the array start,
+  // positions of a group are increasing
+  using DocumentPositions = CowArray<uint32_t>;
+
+  // Documents of a slice of an AddDocuments batch. Words get local ids in
+  // order of appearance and ordinals are indexes in the batch
+  struct PartialIndex {
+    size_t first_document = 0;
+    size_t last_document = 0;
+    std::vector<std::string_view> words;               // index - local id
+    std::vector<std::vector<Posting>> postings;         // index - local id
+    std::vector<std::vector<TermFreq>> document_terms; // local ids
+    std::vector<std::vector<TermId>> document_words;   // local ids in order
+    std::vector<std::vector<uint32_t>> document_positions;
+    std::vector<uint32_t> word_counts;
+    std::exception_ptr error;
+  };
+
+  // Record of a modification in the mutation log
+  struct LoggedMutation {
+    std::shared_ptr<MutationLog> log;
+    uint64_t sequence = 0;
+  };
+
+  // Removed documents whose postings are being erased
+  struct RemovalBatch {
+    std::vector<int> ordinals;
+    std::vector<TermId> terms; // terms of the removed documents, unique
+  };
+
+  // Postings of the query words in one segment or in the write buffer, plus
+  // words come with their weights. Queries with required words are scored by
+  // intersecting the required postings, rarest first, and looking the plus
+  // words up in the forward index
+  struct SegmentPostings {
+    int first_ordinal;
+    int last_ordinal;
+    std::vector<std::pair<PostingRange, double>> plus;
+    std::vector<PostingRange> minus;
+    std::vector<PostingRange> required;
+    std::vector<std::pair<TermId, double>> plus_terms;
+    // Phrases of the query, it outlives the postings
+    const std::vector<std::vector<TermId>> *phrases = nullptr;
+  };
+
+  // Ordinals [first_ordinal, last_ordinal) of a segment scored by one task
+  struct ScoringChunk {
+    size_t segment;
+    int first_ordinal;
+    int last_ordinal;
+  };
+
+  // Filter of the scoring calling a user predicate with the fields of the
+  // document, the slow counterpart of FilterMask
+  template <typename PredicateT> class PredicateFilter {
+  public:
+    PredicateFilter(const std::vector<DocumentData> &documents,
+                    PredicateT predicate)
+        : documents_(&documents), predicate_(predicate) {}
+
+    void Reset(int, int) {}
+    bool operator()(int ordinal) {
+      const DocumentData &document = (*documents_)[ordinal];
+      return predicate_(document.id, document.status, document.rating);
+    }
+
+  private:
+    const std::vector<DocumentData> *documents_;
+    PredicateT predicate_;
   };
 
-  std::set<std::string, std::less<>> stop_words_;
-  std::map<std::string_view, std::map<int, double>>
-      word_to_document_freqs_; // key - words, value - map of (document_id, TF)
-  std::map<int, std::map<std::string_view, double>>
-      id_to_word_freqs_; // key - document_id, value - map of (word, TF)
-  std::map<int, DocumentData>
-      documents_; // key - document_id, value - struct of (rating, status)
+  // Parallel AddDocuments doesn't make slices of fewer documents than this
+  static constexpr size_t MIN_INGESTION_SLICE_DOCUMENTS = 256;
+  // Parallel scoring doesn't make chunks of fewer postings than this
+  static constexpr size_t MIN_SCORING_CHUNK_POSTINGS = 16384;
+  // Chunks per pool thread, extra chunks are there to be stolen
+  static constexpr size_t SCORING_CHUNKS_PER_THREAD = 4;
+  // Posting lists the background compaction rewrites without letting
+  // queries in
+  static constexpr size_t COMPACTION_BATCH_TERMS = 64;
+  static constexpr size_t DEFAULT_WRITE_BUFFER_POSTINGS = 1 << 16;
+  // Segments of a tier hold up to this many times more postings than
+  // segments of the tier below, this many adjacent segments of one tier are
+  // merged into a segment of the next tier
+  static constexpr size_t SEGMENT_MERGE_FACTOR = 4;
+  // Segments beyond this are merged even if their tiers differ
+  static constexpr size_t MAX_SEGMENTS = 32;
+
+  // Words of the documents and the stop words, owns their bytes
+  TermDictionary dictionary_;
+  std::vector<TermData> terms_; // index - TermId
+  // Every added document gets the next ordinal, it indexes documents_ and
+  // dense per-query arrays. Ordinals of removed documents are not reused
+  std::vector<DocumentData> documents_; // index - ordinal
+  // Statuses, ratings and ids of documents_ for DocumentFilter
+  FilterColumns filter_columns_;
+  // index - ordinal, true if the document is removed. Queries skip postings
+  // of removed documents until the compaction or a merge erases them
+  std::vector<bool> tombstones_;
+  std::vector<DocumentTerms> document_terms_;         // index - ordinal
+  std::vector<DocumentPositions> document_positions_; // index - ordinal
+  std::map<int, int> document_ordinals_; // key - document_id, value - ordinal
   std::set<int> document_ids_;
-  std::deque<std::string> storage_; // Every document's word storage
+  // Sealed segments in ordinal order, they cover [0, buffer_first_ordinal_)
+  std::vector<SegmentEntry> segments_;
+  // Documents with greater ordinals have their postings in terms_
+  int buffer_first_ordinal_ = 0;
+  std::vector<TermId> buffer_terms_; // terms with postings in the buffer
+  size_t buffer_postings_ = 0;
+  size_t max_buffer_postings_ = DEFAULT_WRITE_BUFFER_POSTINGS;
+  std::shared_ptr<WorkStealingPool> scoring_pool_ =
+      WorkStealingPool::GetDefault();
+  // Changes with every modification of the documents, cached results of
+  // other epochs are stale
+  uint64_t index_epoch_ = 0;
+  // log of the number of documents, the other half of every IDF
+  double log_document_count_ = 0;
+  // Words of the live documents, for the average length of BM25
+  uint64_t live_word_count_ = 0;
+  std::unique_ptr<ResultCache> result_cache_;
+
+  // Guards the index: queries hold it shared, modifications and every
+  // compaction batch exclusively. Modifications parse their text under the
+  // shared lock first, so queries wait only for the index update itself
+  mutable std::shared_mutex index_mutex_;
+  // Changes when LoadSnapshot replaces the stop words, text split under the
+  // shared lock with other stop words is split again
+  uint64_t stop_words_version_ = 0;
+  bool soft_delete_ = false;
+  bool dynamic_pruning_ = true;
+  std::vector<int> pending_removals_; // ordinals waiting for compaction
+  bool compacting_ = false;
+  bool stop_compaction_ = false;
+  std::condition_variable_any compaction_wake_;
+  std::condition_variable_any compaction_done_;
+  std::thread compactor_;
+  bool merging_ = false;
+  bool stop_merging_ = false;
+  std::condition_variable_any merge_wake_;
+  std::condition_variable_any merge_done_;
+  std::thread merger_;
+  // Snapshot the index was loaded from, mapped while any list views it
+  std::shared_ptr<const MappedFile> snapshot_;
+  std::shared_ptr<MutationLog> mutation_log_;
 
   bool IsStopWord(const std::string &word) const;
   bool IsStopWord(const std::string_view word) const;
+  // Throws if the word has special symbols, ignores empty words
+  void AddStopWord(const std::string_view word);
+  // Returns id of the word, adding it to the index if needed
+  TermId InternTerm(const std::string_view word);
+  // Drops references of a removed document to its terms, terms left without
+  // documents are removed from the index
+  void ReleaseTerms(const DocumentTerms &document_terms);
+  // Appends the removal to the mutation log, if there is one. Called under
+  // the exclusive lock, so the log has modifications in the order of the
+  // index
+  LoggedMutation LogRemoval(const std::vector<int> &document_ids);
+  // Waits for the record to become durable, called without the lock so
+  // other modifications join the same sync
+  static void WaitDurable(const LoggedMutation &logged);
+  // Removal without soft delete, the caller holds the exclusive lock
+  void EraseDocument(const std::execution::sequenced_policy &,
+                     int document_id);
+  void EraseDocument(const std::execution::parallel_policy &, int document_id);
+  // Forgets id of the document and marks its ordinal removed, posting lists
+  // are not touched. Returns the ordinal or -1 for an unexisting document
+  int MarkRemoved(int document_id);
+  // Soft delete of the documents, compaction is left to the compactor_
+  void DeferRemoval(const std::vector<int> &document_ids);
+  // Marks the documents removed and collects the terms to compact
+  RemovalBatch PrepareRemoval(const std::vector<int> &document_ids);
+  // Unique terms of the removed documents
+  std::vector<TermId> CollectTerms(const std::vector<int> &ordinals) const;
+  // Erases postings of all removed documents from the list of the term,
+  // lists of different terms may be compacted concurrently
+  void CompactPostings(TermId term);
+  // Clears forward index of the removed documents and releases their terms
+  void FinishRemoval(const RemovalBatch &batch);
+  // Body of the compactor_ thread
+  void CompactInBackground();
+
+  // Adds the posting to the write buffer
+  void AddPosting(TermId term, int ordinal, double term_freq);
+  // Turns the write buffer into a new segment if it is full
+  void SealWriteBufferIfFull();
+  void SealWriteBuffer();
+  // Segment holding the ordinal, nullptr if it is in the write buffer
+  SegmentEntry *FindSegment(int ordinal);
+  // Returns [first, last) indexes of segments to merge next, an empty
+  // range if none need merging
+  std::pair<size_t, size_t> PickSegmentsToMerge() const;
+  // Body of the merger_ thread
+  void MergeInBackground();
 
   // A valid word must not contain special characters(in the halfinterval of
   // ['\0', ' '))
@@ -122,232 +498,574 @@ private:
   std::vector<std::string_view>
   SplitIntoWordsNoStop(std::string_view str) const;
 
+  // Turns the terms of a document, one per word, into its sorted forward
+  // index. TF is the number of occurrences times the inverse number of
+  // words, computed just so, as sealed segments recompute it from counts
+  static std::vector<TermFreq> CountTermFreqs(std::vector<TermId> terms);
+  // Positions of the words of a document, one term per word in order, for
+  // its forward index
+  static std::vector<uint32_t>
+  CollectPositions(const std::vector<TermId> &words,
+                   const std::vector<TermFreq> &document_terms);
+  // Checks the offsets of positions of a snapshot document, so lookups
+  // stay inside its size elements
+  static bool ValidatePositions(const uint32_t *positions, size_t term_count,
+                                size_t size);
+  // Checks that the terms of a snapshot document are increasing ids less
+  // than term_count, so lookups by them stay inside the index, and that
+  // their TFs are finite and in (0, 1]
+  static bool ValidateDocumentTerms(const TermFreq *document_terms,
+                                    size_t size, size_t term_count);
+  // 1 / word_count, 0 for a document without words
+  static double ComputeInverseWordCount(size_t word_count);
+  // Occurrences of a word in the document from its TF
+  static uint32_t CountOccurrences(double term_freq,
+                                   const DocumentData &document);
+  // Throws if the document is in the index already
+  void CheckNewDocumentId(int document_id) const;
+  // Throws if an id is negative, repeated or in the index already
+  void CheckNewDocumentIds(const std::vector<NewDocument> &documents) const;
+  // Tokenises documents of the slice, errors are kept in partial.error
+  void TokenizeDocuments(const std::vector<NewDocument> &documents,
+                         PartialIndex &partial) const;
+  // Adds a batch tokenised into partial indexes, in parallel if asked
+  void MergePartialIndexes(const std::vector<NewDocument> &documents,
+                           std::vector<PartialIndex> &partials, bool parallel);
+  // Splits the batch into slices, tokenises and merges them
+  void AddDocumentsInSlices(const std::vector<NewDocument> &documents,
+                            size_t slice_count);
+
   // Input: vector of ratings, output: average rating
   static int ComputeAverageRating(const std::vector<int> &ratings);
 
   // Input: word, if first character is '-', remove it, add is_minus flag to the
-  // word
+  // word; '+' marks a required word the same way
   QueryWord ParseQueryWord(std::string_view word) const;
 
-  template <typename ExecutionPolicy>
-  Query ParseQuery(ExecutionPolicy &&, const std::string_view text) const;
-  /*Query ParseQuerySeq(const std::string_view text) const;
-  Query ParseQueryPar(const std::string_view text) const;*/
-
-  // Calculating IDF as log(number of documents / number of documents with word
-  // encountered in them Input: word we are calculating IDF for
-  double ComputeWordInverseDocumentFreq(const std::string_view word) const;
-
-  // Finding all of the documents of the given status
-  // Input: query (line of words), predicate function object, output: vector of
-  // documents Predicate is receiving (document_id, status, rating) returning
-  // bool, used to filter documents
-  template <typename PredicateT>
-  std::vector<Document> FindAllDocuments(const Query &query,
-                                         PredicateT predicate) const;
-  template <typename PredicateT>
+  // Words are validated and looked up in the dictionary once, words the
+  // index doesn't know can't match anything and are dropped. Words in
+  // double quotes make a phrase, its words are required and must follow
+  // each other in the document
+  Query ParseQuery(const std::string_view text) const;
+
+  // Statistics scorers of the queries are built from
+  CorpusStats GetCorpusStats() const;
+  // Weights of the plus words of the query, index - index in plus_terms
+  template <typename Scorer>
+  std::vector<double> ComputeWordWeights(const Scorer &scorer,
+                                         const Query &query) const;
+  // Sets document frequency of the term and its logarithm
+  static void SetDocumentFreq(TermData &term_data, size_t document_freq);
+  // Called after documents are added or removed: makes cached results stale
+  // and refreshes the log of the number of documents
+  void OnDocumentsChanged();
+
+  // Returns true if the term is present in the document
+  bool DocumentHasTerm(TermId term, int ordinal) const;
+  // TF of the term in the document, zero if it isn't there
+  double GetTermFreq(TermId term, int ordinal) const;
+  // Returns true if the words of the phrase follow each other in the
+  // document
+  bool DocumentHasPhrase(const std::vector<TermId> &phrase, int ordinal) const;
+  // Returns true if the document has every required word and phrase
+  bool DocumentHasRequired(const Query &query, int ordinal) const;
+
+  // Returns words of the matched terms in alphabetical order
+  std::vector<std::string_view>
+  GetSortedWords(const std::vector<TermId> &terms) const;
+
+  // Finding all of the documents the filter lets through
+  // Input: query (line of words), filter, number of documents to return,
+  // output: vector of the result_count most relevant documents, sorted.
+  // Filter is a FilterMask or a PredicateFilter: Reset(first_ordinal,
+  // last_ordinal) before scoring a range, then operator()(ordinal)
+  // returning bool. Parallel tasks filter with copies of it
+  template <typename Scorer, typename FilterT>
+  std::vector<Document> FindAllDocuments(const Query &query, FilterT filter,
+                                         size_t result_count) const;
+  template <typename Scorer, typename FilterT>
   std::vector<Document>
   FindAllDocuments(const std::execution::sequenced_policy &, const Query &query,
-                   PredicateT predicate) const;
-  template <typename PredicateT>
+                   FilterT filter, size_t result_count) const;
+  template <typename Scorer, typename FilterT>
   std::vector<Document>
   FindAllDocuments(const std::execution::parallel_policy &, const Query &query,
-                   PredicateT predicate) const;
+                   FilterT filter, size_t result_count) const;
+
+  // Postings of the query words found in the index, segment by segment,
+  // plus words come with their weights, index - index in plus_terms.
+  // Segments without plus words or missing a required word are left out
+  std::vector<SegmentPostings>
+  ResolveQuery(const Query &query,
+               const std::vector<double> &word_weights) const;
+
+  // Splits the segments into ordinal ranges holding roughly equal numbers
+  // of the query postings, enough of them to balance the scoring pool.
+  // Returns a single chunk if the query is too small to split
+  std::vector<ScoringChunk>
+  SplitIntoScoringChunks(const std::vector<SegmentPostings> &segments) const;
+
+  // Scores documents with ordinals in [first_ordinal, last_ordinal) into the
+  // accumulator of the calling thread and adds the matches to
+  // matched_documents
+  template <typename Scorer, typename FilterT>
+  void ScoreOrdinalRange(int first_ordinal, int last_ordinal,
+                         const SegmentPostings &postings, const Scorer &scorer,
+                         FilterT &filter,
+                         TopDocuments &matched_documents) const;
+  // The same with dynamic pruning: only documents that may enter
+  // matched_documents are scored
+  template <typename Scorer, typename FilterT>
+  void ScoreTopOrdinals(int first_ordinal, int last_ordinal,
+                        const SegmentPostings &postings, const Scorer &scorer,
+                        FilterT &filter,
+                        TopDocuments &matched_documents) const;
 };
 
 template <typename ContainerT>
 SearchServer::SearchServer(const ContainerT &container) {
   for (const std::string &word : container) {
-    if (!IsValidWord(word)) {
-      throw std::invalid_argument("Invalid symbols in the list of stop words.");
-    }
-    if (!word.empty()) {
-      stop_words_.insert(word);
-    }
+    AddStopWord(word);
   }
 }
 
-template <typename PredicateT>
+template <typename Scorer, typename PredicateT>
 std::vector<Document>
 SearchServer::FindTopDocuments(const std::string_view raw_query,
                                PredicateT predicate) const {
-  return FindTopDocuments(std::execution::seq, raw_query, predicate);
+  return FindTopDocuments<Scorer>(std::execution::seq, raw_query, predicate);
+}
+
+template <typename Scorer>
+std::vector<Document>
+SearchServer::FindTopDocuments(const std::string_view raw_query,
+                               DocumentStatus status) const {
+  return FindTopDocuments<Scorer>(std::execution::seq, raw_query, status);
 }
 
-template <typename ExecutionPolicy, typename PredicateT>
+template <typename Scorer>
+std::vector<Document>
+SearchServer::FindTopDocuments(const std::string_view raw_query,
+                               const DocumentFilter &filter) const {
+  return FindTopDocuments<Scorer>(std::execution::seq, raw_query, filter);
+}
+
+template <typename Scorer>
+std::vector<Document>
+SearchServer::FindTopDocuments(const std::string_view raw_query) const {
+  return FindTopDocuments<Scorer>(std::execution::seq, raw_query,
+                                  DocumentStatus::ACTUAL);
+}
+
+template <typename Scorer, typename ExecutionPolicy, typename PredicateT>
 std::vector<Document>
 SearchServer::FindTopDocuments(ExecutionPolicy &&pol,
                                const std::string_view raw_query,
                                PredicateT predicate) const {
-  std::vector<Document> result;
+  return FindTopDocuments<Scorer>(pol, raw_query, predicate,
+                                  MAX_RESULT_DOCUMENT_COUNT);
+}
+
+template <typename Scorer, typename ExecutionPolicy, typename PredicateT>
+std::vector<Document>
+SearchServer::FindTopDocuments(ExecutionPolicy &&pol,
+                               const std::string_view raw_query,
+                               PredicateT predicate,
+                               size_t result_count) const {
   if (raw_query.empty()) {
-    return result;
+    return {};
   }
-  Query query = ParseQuery(std::execution::seq, raw_query);
-  result = FindAllDocuments(pol, query, predicate);
-
-  std::sort(std::execution::par, std::begin(result), std::end(result),
-            [](const Document &lhs, const Document &rhs) {
-              if (AlmostEqualRelative(lhs.relevance, rhs.relevance)) {
-                return lhs.rating > rhs.rating;
-              } else {
-                return lhs.relevance > rhs.relevance;
-              }
-            });
-  if (result.size() > MAX_RESULT_DOCUMENT_COUNT) {
-    result.resize(MAX_RESULT_DOCUMENT_COUNT);
-  }
-  return result;
+  std::shared_lock lock(index_mutex_);
+  Query query = ParseQuery(raw_query);
+  return FindAllDocuments<Scorer>(
+      pol, query, PredicateFilter<PredicateT>(documents_, predicate),
+      result_count);
 }
 
-template <typename ExecutionPolicy>
+template <typename Scorer, typename ExecutionPolicy>
 std::vector<Document>
 SearchServer::FindTopDocuments(ExecutionPolicy &&pol,
                                const std::string_view raw_query) const {
-  const auto lambda = [](int, DocumentStatus status, int) {
-    return status == DocumentStatus::ACTUAL;
-  };
-  return FindTopDocuments(pol, raw_query, lambda);
+  return FindTopDocuments<Scorer>(pol, raw_query, DocumentStatus::ACTUAL);
 }
 
-template <typename ExecutionPolicy>
+template <typename Scorer, typename ExecutionPolicy>
 std::vector<Document>
 SearchServer::FindTopDocuments(ExecutionPolicy &&pol,
                                const std::string_view raw_query,
                                DocumentStatus status) const {
+  return FindTopDocuments<Scorer>(pol, raw_query, status,
+                                  MAX_RESULT_DOCUMENT_COUNT);
+}
 
-  const auto lambda = [status](int, DocumentStatus status1, int) {
-    return status1 == status;
-  };
+template <typename Scorer, typename ExecutionPolicy>
+std::vector<Document>
+SearchServer::FindTopDocuments(ExecutionPolicy &&pol,
+                               const std::string_view raw_query,
+                               const DocumentFilter &filter) const {
+  return FindTopDocuments<Scorer>(pol, raw_query, filter,
+                                  MAX_RESULT_DOCUMENT_COUNT);
+}
 
-  return FindTopDocuments(pol, raw_query, lambda);
+template <typename Scorer, typename ExecutionPolicy>
+std::vector<Document>
+SearchServer::FindTopDocuments(ExecutionPolicy &&pol,
+                               const std::string_view raw_query,
+                               DocumentStatus status,
+                               size_t result_count) const {
+  return FindTopDocuments<Scorer>(pol, raw_query, DocumentFilter(status),
+                                  result_count);
 }
 
-template <typename ExecutionPolicy>
-SearchServer::Query
-SearchServer::ParseQuery(ExecutionPolicy &&,
-                         const std::string_view text) const {
-  Query result;
-  for (const std::string_view word : SplitIntoWordsNoStop(text)) {
-    const QueryWord query_word = ParseQueryWord(word);
-    if (query_word.is_minus) {
-      result.minus_words.emplace_back(query_word.data);
-    } else {
-      result.plus_words.emplace_back(query_word.data);
-    }
+template <typename Scorer, typename ExecutionPolicy>
+std::vector<Document>
+SearchServer::FindTopDocuments(ExecutionPolicy &&pol,
+                               const std::string_view raw_query,
+                               const DocumentFilter &filter,
+                               size_t result_count) const {
+  if (raw_query.empty()) {
+    return {};
+  }
+  std::shared_lock lock(index_mutex_);
+  const Query query = ParseQuery(raw_query);
+  // Unknown required words aren't in the key, such queries aren't cached
+  if (!result_cache_ || query.matches_nothing) {
+    return FindAllDocuments<Scorer>(
+        pol, query, FilterMask(filter_columns_, filter), result_count);
   }
-  // Erasing duplicates from plus and minus words
-  // Only for a sequenced policy
-  if (std::is_same_v<std::decay_t<ExecutionPolicy>,
-                     std::execution::sequenced_policy>) {
-    std::sort(result.minus_words.begin(), result.minus_words.end());
-    std::sort(result.plus_words.begin(), result.plus_words.end());
-    const std::vector<std::string_view>::iterator last_minus =
-        std::unique(result.minus_words.begin(), result.minus_words.end());
-    const std::vector<std::string_view>::iterator last_plus =
-        std::unique(result.plus_words.begin(), result.plus_words.end());
-    result.minus_words.erase(last_minus, result.minus_words.end());
-    result.plus_words.erase(last_plus, result.plus_words.end());
+  // Modifications wait for the lock, so the epoch holds until the results
+  // are cached
+  ResultCacheKey key{query.plus_terms, query.minus_terms,
+                     query.required_terms, query.phrases, Scorer::NAME,
+                     filter, result_count};
+  std::vector<Document> result;
+  if (!result_cache_->Find(key, index_epoch_, result)) {
+    result = FindAllDocuments<Scorer>(
+        pol, query, FilterMask(filter_columns_, filter), result_count);
+    result_cache_->Insert(std::move(key), index_epoch_, result);
   }
   return result;
 }
 
-template <typename PredicateT>
+template <typename Scorer, typename ExecutionPolicy, typename PredicateT>
 std::vector<Document>
-SearchServer::FindAllDocuments(const Query &query, PredicateT predicate) const {
-  return FindAllDocuments(std::execution::seq, query, predicate);
+SearchServer::FindTopDocuments(ExecutionPolicy &&pol,
+                               const std::string_view raw_query,
+                               PredicateT predicate, size_t offset,
+                               size_t limit) const {
+  std::vector<Document> result =
+      FindTopDocuments<Scorer>(pol, raw_query, predicate, offset + limit);
+  result.erase(result.begin(),
+               result.begin() + std::min(offset, result.size()));
+  return result;
 }
 
-template <typename PredicateT>
+template <typename Scorer, typename ExecutionPolicy>
+std::vector<Document>
+SearchServer::FindTopDocuments(ExecutionPolicy &&pol,
+                               const std::string_view raw_query,
+                               DocumentStatus status, size_t offset,
+                               size_t limit) const {
+  return FindTopDocuments<Scorer>(pol, raw_query, DocumentFilter(status),
+                                  offset, limit);
+}
+
+template <typename Scorer, typename ExecutionPolicy>
+std::vector<Document>
+SearchServer::FindTopDocuments(ExecutionPolicy &&pol,
+                               const std::string_view raw_query,
+                               const DocumentFilter &filter, size_t offset,
+                               size_t limit) const {
+  std::vector<Document> result =
+      FindTopDocuments<Scorer>(pol, raw_query, filter, offset + limit);
+  result.erase(result.begin(),
+               result.begin() + std::min(offset, result.size()));
+  return result;
+}
+
+template <typename Scorer>
+std::vector<double>
+SearchServer::ComputeWordWeights(const Scorer &scorer,
+                                 const Query &query) const {
+  std::vector<double> word_weights;
+  word_weights.reserve(query.plus_terms.size());
+  for (const TermId term : query.plus_terms) {
+    const TermData &term_data = terms_[term];
+    word_weights.push_back(scorer.GetWordWeight(term_data.document_freq,
+                                                term_data.log_document_freq));
+  }
+  return word_weights;
+}
+
+template <typename Scorer, typename FilterT>
+std::vector<Document>
+SearchServer::FindAllDocuments(const Query &query, FilterT filter,
+                               size_t result_count) const {
+  return FindAllDocuments<Scorer>(std::execution::seq, query, filter,
+                                  result_count);
+}
+
+template <typename Scorer, typename FilterT>
 std::vector<Document>
 SearchServer::FindAllDocuments(const std::execution::sequenced_policy &,
-                               const Query &query, PredicateT predicate) const {
-  std::map<int, double>
-      document_to_relevance; // Key - document ID, value - relevance
-  std::for_each(
-      std::execution::seq, query.plus_words.begin(), query.plus_words.end(),
-      [&, predicate](const std::string_view &word) {
-        if (word_to_document_freqs_.count(word)) {
-          const double inverse_document_freq =
-              ComputeWordInverseDocumentFreq(word);
-          for (const auto [document_id, term_freq] :
-               word_to_document_freqs_.at(word)) {
-            const DocumentData &current_document =
-                documents_.at(document_id); // Adding reference to call .at()
-                                            // method once, instead of 2 times
-            if (predicate(document_id, current_document.status,
-                          current_document.rating)) {
-              document_to_relevance[document_id] +=
-                  term_freq * inverse_document_freq;
-            }
-          }
-        }
-      });
-
-  std::for_each(std::execution::seq, query.minus_words.begin(),
-                query.minus_words.end(), [&](const std::string_view &word) {
-                  if (word_to_document_freqs_.count(word)) {
-                    for (const auto [document_id, _] :
-                         word_to_document_freqs_.at(word)) {
-                      document_to_relevance.erase(document_id);
-                    }
-                  }
-                });
-  std::vector<Document> matched_documents;
-  for (const auto [document_id, relevance] : document_to_relevance) {
-    matched_documents.push_back(
-        {document_id, relevance,
-         documents_.at(document_id)
-             .rating}); // Moving everything from index to the vector<Document>
+                               const Query &query, FilterT filter,
+                               size_t result_count) const {
+  const Scorer scorer(GetCorpusStats());
+  TopDocuments matched_documents(result_count);
+  for (const SegmentPostings &postings :
+       ResolveQuery(query, ComputeWordWeights(scorer, query))) {
+    ScoreOrdinalRange(postings.first_ordinal, postings.last_ordinal, postings,
+                      scorer, filter, matched_documents);
   }
-  return matched_documents;
+  return matched_documents.Extract();
 }
 
-template <typename PredicateT>
+template <typename Scorer, typename FilterT>
 std::vector<Document>
 SearchServer::FindAllDocuments(const std::execution::parallel_policy &,
-                               const Query &query, PredicateT predicate) const {
-  static int BUCKET_COUNT = 8;
-  ConcurrentMap<int, double> document_to_relevance(
-      BUCKET_COUNT); // Key - document ID, value - relevance
-
-  std::for_each(
-      std::execution::par, query.plus_words.begin(), query.plus_words.end(),
-      [&, predicate](const std::string_view &word) {
-        if (word_to_document_freqs_.count(word)) {
-          const double inverse_document_freq =
-              ComputeWordInverseDocumentFreq(word);
-          for (const auto [document_id, term_freq] :
-               word_to_document_freqs_.at(word)) {
-            const DocumentData &current_document =
-                documents_.at(document_id); // Adding reference to call .at()
-                                            // method once, instead of 2 times
-            if (predicate(document_id, current_document.status,
-                          current_document.rating)) {
-              document_to_relevance[document_id].ref_to_value +=
-                  term_freq * inverse_document_freq;
+                               const Query &query, FilterT filter,
+                               size_t result_count) const {
+  // Chunks cover disjoint ordinal ranges, so every task scores into its own
+  // accumulator without locks and only the partial tops are merged. Long
+  // posting lists are cut into several chunks, so even a one-word query
+  // keeps every thread busy
+  const Scorer scorer(GetCorpusStats());
+  const std::vector<SegmentPostings> segments =
+      ResolveQuery(query, ComputeWordWeights(scorer, query));
+  const std::vector<ScoringChunk> chunks = SplitIntoScoringChunks(segments);
+  if (chunks.size() <= 1) {
+    TopDocuments matched_documents(result_count);
+    for (const SegmentPostings &postings : segments) {
+      ScoreOrdinalRange(postings.first_ordinal, postings.last_ordinal,
+                        postings, scorer, filter, matched_documents);
+    }
+    return matched_documents.Extract();
+  }
+  std::vector<TopDocuments> partial_tops(chunks.size(),
+                                         TopDocuments(result_count));
+  scoring_pool_->ParallelFor(chunks.size(), [&](size_t i) {
+    const ScoringChunk &chunk = chunks[i];
+    FilterT chunk_filter = filter;
+    ScoreOrdinalRange(chunk.first_ordinal, chunk.last_ordinal,
+                      segments[chunk.segment], scorer, chunk_filter,
+                      partial_tops[i]);
+  });
+
+  TopDocuments matched_documents(result_count);
+  for (const TopDocuments &partial_top : partial_tops) {
+    matched_documents.Merge(partial_top);
+  }
+  return matched_documents.Extract();
+}
+
+template <typename Scorer, typename FilterT>
+void SearchServer::ScoreOrdinalRange(int first_ordinal, int last_ordinal,
+                                     const SegmentPostings &postings,
+                                     const Scorer &scorer, FilterT &filter,
+                                     TopDocuments &matched_documents) const {
+  filter.Reset(first_ordinal, last_ordinal);
+  if (!postings.required.empty()) {
+    // Candidates are the documents with all the required words, each of
+    // them is checked and scored once
+    std::vector<PostingCursor> required;
+    for (const PostingRange &range : postings.required) {
+      required.emplace_back(range);
+    }
+    std::vector<PostingCursor> minus;
+    for (const PostingRange &range : postings.minus) {
+      minus.emplace_back(range);
+    }
+    ForEachCommonOrdinal(
+        required, first_ordinal, last_ordinal, [&](int ordinal) {
+          if (tombstones_[ordinal]) {
+            return;
+          }
+          for (PostingCursor &cursor : minus) {
+            cursor.SkipTo(ordinal);
+            if (cursor.GetOrdinal() == ordinal) {
+              return;
             }
           }
-        }
-      });
-
-  std::for_each(std::execution::par, query.minus_words.begin(),
-                query.minus_words.end(), [&](const std::string_view &word) {
-                  if (word_to_document_freqs_.count(word)) {
-                    for (const auto [document_id, _] :
-                         word_to_document_freqs_.at(word)) {
-                      document_to_relevance.Erase(document_id);
-                    }
-                  }
-                });
-
-  std::vector<Document> matched_documents;
-  for (const auto [document_id, relevance] :
-       document_to_relevance.BuildOrdinaryMap()) {
-    matched_documents.push_back(
-        {document_id, relevance,
-         documents_.at(document_id)
-             .rating}); // Moving everything from index to the vector<Document>
+          for (const std::vector<TermId> &phrase : *postings.phrases) {
+            if (!DocumentHasPhrase(phrase, ordinal)) {
+              return;
+            }
+          }
+          if (!filter(ordinal)) {
+            return;
+          }
+          const DocumentData &document = documents_[ordinal];
+          // Summed in the order of the plus postings, as the accumulator does
+          double relevance = 0;
+          for (const auto &[term, word_weight] : postings.plus_terms) {
+            relevance += scorer.Score(word_weight, GetTermFreq(term, ordinal),
+                                      document.inverse_word_count);
+          }
+          matched_documents.Add({document.id, relevance, document.rating});
+        });
+    return;
+  }
+  if (dynamic_pruning_) {
+    ScoreTopOrdinals(first_ordinal, last_ordinal, postings, scorer, filter,
+                     matched_documents);
+    return;
+  }
+
+  RelevanceAccumulator &document_to_relevance = GetThreadAccumulator();
+  document_to_relevance.Reset(first_ordinal, last_ordinal - first_ordinal);
+
+  // Minus words go first, so excluded documents are neither filtered nor
+  // scored
+  for (const PostingRange &minus_postings : postings.minus) {
+    minus_postings.ForEach(first_ordinal, last_ordinal,
+                           [&](int ordinal, double) {
+                             document_to_relevance.Exclude(ordinal);
+                           });
+  }
+
+  for (const auto &[plus_postings, plus_weight] : postings.plus) {
+    // Structured bindings can't be captured before C++20
+    const double word_weight = plus_weight;
+    plus_postings.ForEach(
+        first_ordinal, last_ordinal, [&](int ordinal, double term_freq) {
+          if (document_to_relevance.IsExcluded(ordinal) ||
+              tombstones_[ordinal]) {
+            return;
+          }
+          if (filter(ordinal)) {
+            document_to_relevance.Add(
+                ordinal, scorer.Score(word_weight, term_freq,
+                                      documents_[ordinal].inverse_word_count));
+          }
+        });
   }
-  return matched_documents;
-}
\ No newline at end of file
+
+  // Only the best documents are kept while collecting matches
+  document_to_relevance.ForEachMatched([&](int ordinal, double relevance) {
+    const DocumentData &document = documents_[ordinal];
+    matched_documents.Add({document.id, relevance, document.rating});
+  });
+}
+
+template <typename Scorer, typename FilterT>
+void SearchServer::ScoreTopOrdinals(int first_ordinal, int last_ordinal,
+                                    const SegmentPostings &postings,
+                                    const Scorer &scorer, FilterT &filter,
+                                    TopDocuments &matched_documents) const {
+  // Bounds are summed in another order than relevance, the slack covers
+  // the rounding
+  double threshold = matched_documents.GetMinRelevanceToKeep();
+  const auto may_keep = [&threshold](double relevance_bound) {
+    return relevance_bound * (1 + 1e-12) >= threshold;
+  };
+  const size_t list_count = postings.plus.size();
+  std::vector<PostingCursor> cursors;
+  std::vector<double> max_scores;
+  cursors.reserve(list_count);
+  for (const auto &[range, word_weight] : postings.plus) {
+    cursors.emplace_back(range);
+    cursors.back().SkipTo(first_ordinal);
+    max_scores.push_back(
+        scorer.GetMaxScore(word_weight, range.GetMaxTermFreq()));
+  }
+  std::vector<PostingCursor> minus;
+  minus.reserve(postings.minus.size());
+  for (const PostingRange &range : postings.minus) {
+    minus.emplace_back(range);
+  }
+  // Lists by growing bound. Documents only in the first lists, whose bounds
+  // sum up to less than the results need, are never candidates
+  std::vector<size_t> order(list_count);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&max_scores](size_t lhs, size_t rhs) {
+    return max_scores[lhs] < max_scores[rhs];
+  });
+  std::vector<double> bound_sums(list_count + 1); // of the first lists
+  for (size_t k = 0; k < list_count; ++k) {
+    bound_sums[k + 1] = bound_sums[k] + max_scores[order[k]];
+  }
+  size_t first_essential = 0;
+  std::vector<double> scores(list_count); // index - list
+  // Every list has its postings from the last candidate to block_last in
+  // one block, relevance of the documents there is at most block_bound
+  int block_last = first_ordinal - 1;
+  double block_bound = 0;
+  while (true) {
+    while (first_essential < list_count &&
+           !may_keep(bound_sums[first_essential + 1])) {
+      ++first_essential;
+    }
+    int candidate = PostingCursor::END;
+    for (size_t k = first_essential; k < list_count; ++k) {
+      candidate = std::min(candidate, cursors[order[k]].GetOrdinal());
+    }
+    if (candidate >= last_ordinal) {
+      return;
+    }
+
+    // If the block bounds don't make it the whole run is skipped
+    if (candidate > block_last) {
+      block_last = PostingCursor::END;
+      block_bound = 0;
+      for (size_t i = 0; i < list_count; ++i) {
+        cursors[i].SkipBlocksTo(candidate);
+        block_bound += scorer.GetMaxScore(postings.plus[i].second,
+                                          cursors[i].GetBlockMaxTermFreq());
+        block_last = std::min(block_last, cursors[i].GetBlockLastOrdinal());
+      }
+    }
+    if (!may_keep(block_bound)) {
+      for (size_t k = first_essential; k < list_count; ++k) {
+        cursors[order[k]].SkipTo(block_last + 1);
+      }
+      continue;
+    }
+
+    // Essential lists first, then the others while the bound holds
+    const double inverse_word_count = documents_[candidate].inverse_word_count;
+    double score = 0;
+    for (size_t k = first_essential; k < list_count; ++k) {
+      const size_t i = order[k];
+      scores[i] = 0;
+      if (cursors[i].GetOrdinal() == candidate) {
+        scores[i] = scorer.Score(postings.plus[i].second,
+                                 cursors[i].GetTermFreq(), inverse_word_count);
+        score += scores[i];
+        cursors[i].Next();
+      }
+    }
+    bool is_kept = !tombstones_[candidate];
+    for (PostingCursor &cursor : minus) {
+      cursor.SkipTo(candidate);
+      is_kept = is_kept && cursor.GetOrdinal() != candidate;
+    }
+    for (size_t k = first_essential; is_kept && k > 0; --k) {
+      if (!may_keep(score + bound_sums[k])) {
+        is_kept = false;
+        break;
+      }
+      const size_t i = order[k - 1];
+      cursors[i].SkipTo(candidate);
+      scores[i] = 0;
+      if (cursors[i].GetOrdinal() == candidate) {
+        scores[i] = scorer.Score(postings.plus[i].second,
+                                 cursors[i].GetTermFreq(), inverse_word_count);
+        score += scores[i];
+      }
+    }
+    if (!is_kept) {
+      continue;
+    }
+    if (!filter(candidate)) {
+      continue;
+    }
+    const DocumentData &document = documents_[candidate];
+    // Summed in the order of the lists, as the accumulator does
+    double relevance = 0;
+    for (const double list_score : scores) {
+      relevance += list_score;
+    }
+    matched_documents.Add({document.id, relevance, document.rating});
+    threshold = matched_documents.GetMinRelevanceToKeep();
+  }
+}
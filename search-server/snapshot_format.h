@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+
+// Layout of the files written by SearchServer::SaveSnapshot. Every section
+// is an array of plain structs starting at a multiple of 8 bytes, so a
+// mapped file is read in place. Offsets are in bytes from the file start,
+// numbers are in the byte order of the machine that wrote the file.
+//
+// header | terms | words | postings | documents | document terms |
+// document positions
+//
+// Term i describes TermId i, the postings of its list are compressed
+// (compressed_postings.h) from a word of the posting section on, the
+// forward index of every document is a contiguous slice of the document
+// terms section and one of term_count + word_count elements of the
+// document positions section. Documents are stored by ordinal.
+
+const char SNAPSHOT_MAGIC[8] = {'S', 'R', 'C', 'H', 'S', 'N', 'A', 'P'};
+// Bumped on every incompatible change of the layout
+const uint32_t SNAPSHOT_VERSION = 4;
+
+struct SnapshotHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t term_count;
+  uint64_t document_count;
+  uint64_t terms_offset;          // SnapshotTerm[term_count]
+  uint64_t words_offset;          // bytes of the words
+  uint64_t words_size;
+  uint64_t postings_offset;       // uint32_t[posting_words]
+  uint64_t posting_words;
+  uint64_t documents_offset;      // SnapshotDocument[document_count]
+  uint64_t document_terms_offset; // (TermId, TF)[document_term_count]
+  uint64_t document_term_count;
+  uint64_t document_positions_offset; // uint32_t[document_position_count]
+  uint64_t document_position_count;
+  uint64_t file_size;
+};
+
+struct SnapshotTerm {
+  uint64_t word_offset; // from the start of the words section
+  uint64_t first_word;  // from the start of the posting section
+  uint64_t posting_count;
+  uint32_t word_size;
+  uint32_t references; // 0 marks a free id
+  uint32_t is_stop_word;
+  uint32_t reserved;
+};
+
+struct SnapshotDocument {
+  int32_t id;
+  int32_t rating;
+  int32_t status;
+  uint32_t word_count;
+  uint64_t first_term;
+  uint64_t term_count;
+  uint64_t first_position;
+};
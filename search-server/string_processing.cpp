@@ -1,36 +1,147 @@
+#include <stdexcept>
 
 #include "string_processing.h"
 
-// Input: line of text, Output: vector of the words of that text
-std::vector<std::string> SplitIntoWords(const std::string &text) {
-  std::vector<std::string> words;
-  std::string word;
-  for (const char c : text) {
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TOKENIZER_X86
+#endif
+
+namespace {
+
+using TokenizerFunction = bool (*)(std::string_view text,
+                                   std::vector<std::string_view> &words);
+
+// Special characters are the bytes below ' ', whether char is signed or not
+bool IsSpecialCharacter(char c) {
+  return static_cast<unsigned char>(c) < ' ';
+}
+
+// Splits text[position, size) where the word in progress began at start
+bool TokenizeTail(std::string_view text, size_t position, size_t start,
+                  std::vector<std::string_view> &words) {
+  bool valid = true;
+  for (; position < text.size(); ++position) {
+    const char c = text[position];
     if (c == ' ') {
-      if (!word.empty()) {
-        words.push_back(word);
-        word.clear();
-      }
-    } else {
-      word += c;
+      words.push_back(text.substr(start, position - start));
+      start = position + 1;
     }
+    valid &= !IsSpecialCharacter(c);
   }
-  if (!word.empty()) {
-    words.push_back(word);
+  words.push_back(text.substr(start));
+  return valid;
+}
+
+bool TokenizeScalar(std::string_view text,
+                    std::vector<std::string_view> &words) {
+  return TokenizeTail(text, 0, 0, words);
+}
+
+#ifdef TOKENIZER_X86
+
+// Appends the words ending at the spaces of a chunk, one bit per byte
+inline void AddWords(std::string_view text, size_t position, uint32_t spaces,
+                     size_t &start, std::vector<std::string_view> &words) {
+  for (; spaces != 0; spaces &= spaces - 1) {
+    const size_t space = position + __builtin_ctz(spaces);
+    words.push_back(text.substr(start, space - start));
+    start = space + 1;
   }
-  return words;
 }
 
-std::vector<std::string_view> SplitIntoWordsView(std::string_view str) {
-  std::vector<std::string_view> result;
-  while (true) {
-    size_t space = str.find(' ');
-    result.emplace_back(str.substr(0, space));
-    if (space == str.npos) {
-      break;
-    } else {
-      str.remove_prefix(space + 1);
-    }
+// A byte is special if its top three bits are zero
+__attribute__((target("sse2"))) bool
+TokenizeSse2(std::string_view text, std::vector<std::string_view> &words) {
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i high_bits = _mm_set1_epi8(static_cast<char>(0xe0));
+  const __m128i zero = _mm_setzero_si128();
+  __m128i special = zero;
+  size_t start = 0;
+  size_t position = 0;
+  for (; position + 16 <= text.size(); position += 16) {
+    const __m128i chunk = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(text.data() + position));
+    special = _mm_or_si128(
+        special, _mm_cmpeq_epi8(_mm_and_si128(chunk, high_bits), zero));
+    const uint32_t spaces =
+        static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, space)));
+    AddWords(text, position, spaces, start, words);
+  }
+  const bool valid = _mm_movemask_epi8(special) == 0;
+  return TokenizeTail(text, position, start, words) && valid;
+}
+
+__attribute__((target("avx2"))) bool
+TokenizeAvx2(std::string_view text, std::vector<std::string_view> &words) {
+  const __m256i space = _mm256_set1_epi8(' ');
+  const __m256i high_bits = _mm256_set1_epi8(static_cast<char>(0xe0));
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i special = zero;
+  size_t start = 0;
+  size_t position = 0;
+  for (; position + 32 <= text.size(); position += 32) {
+    const __m256i chunk = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(text.data() + position));
+    special = _mm256_or_si256(
+        special, _mm256_cmpeq_epi8(_mm256_and_si256(chunk, high_bits), zero));
+    const uint32_t spaces = static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, space)));
+    AddWords(text, position, spaces, start, words);
+  }
+  const bool valid = _mm256_movemask_epi8(special) == 0;
+  return TokenizeTail(text, position, start, words) && valid;
+}
+
+#endif
+
+TokenizerFunction GetTokenizer(TokenizerKernel kernel) {
+  switch (kernel) {
+#ifdef TOKENIZER_X86
+  case TokenizerKernel::SSE2:
+    return TokenizeSse2;
+  case TokenizerKernel::AVX2:
+    return TokenizeAvx2;
+#endif
+  default:
+    return TokenizeScalar;
+  }
+}
+
+} // namespace
+
+std::vector<TokenizerKernel> GetSupportedTokenizerKernels() {
+  std::vector<TokenizerKernel> kernels = {TokenizerKernel::SCALAR};
+#ifdef TOKENIZER_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse2")) {
+    kernels.push_back(TokenizerKernel::SSE2);
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    kernels.push_back(TokenizerKernel::AVX2);
   }
-  return result;
+#endif
+  return kernels;
+}
+
+bool TokenizeText(std::string_view text, std::vector<std::string_view> &words) {
+  // Chosen on the first call by what the CPU running the process supports,
+  // static objects of other files may tokenise before this file initialises
+  static const TokenizerFunction tokenizer =
+      GetTokenizer(GetSupportedTokenizerKernels().back());
+  return tokenizer(text, words);
+}
+
+bool TokenizeText(std::string_view text, std::vector<std::string_view> &words,
+                  TokenizerKernel kernel) {
+  const std::vector<TokenizerKernel> supported = GetSupportedTokenizerKernels();
+  if (std::find(supported.begin(), supported.end(), kernel) ==
+      supported.end()) {
+    throw std::invalid_argument("Tokenizer kernel isn't supported.");
+  }
+  return GetTokenizer(kernel)(text, words);
+}
+
+bool HasSpecialCharacters(std::string_view text) {
+  return std::any_of(text.begin(), text.end(), IsSpecialCharacter);
 }
@@ -3,28 +3,39 @@
 #include <algorithm>
 #include <set>
 #include <string>
+#include <string_view>
 #include <vector>
 
 std::string ReadLine();
 
 int ReadLineWithNumber();
 
+// Instruction sets the tokeniser has kernels for
+enum class TokenizerKernel { SCALAR, SSE2, AVX2 };
+
+// Kernels this CPU can run, the one TokenizeText picks is the last
+std::vector<TokenizerKernel> GetSupportedTokenizerKernels();
+
+// Splits text at every space in a single pass that also looks for special
+// characters (in the halfinterval of ['\0', ' ')). Adjacent spaces give
+// empty words, so there is always one word more than there are spaces.
+// Words are appended to words, returns false if text has special characters
+bool TokenizeText(std::string_view text, std::vector<std::string_view> &words);
+bool TokenizeText(std::string_view text, std::vector<std::string_view> &words,
+                  TokenizerKernel kernel);
+
+bool HasSpecialCharacters(std::string_view text);
+
 template <typename StringType>
 std::vector<std::decay_t<StringType>> SplitIntoWords(StringType &&text) {
+  std::vector<std::string_view> tokens;
+  TokenizeText(text, tokens);
   std::vector<std::decay_t<StringType>> words;
-  typename std::decay_t<StringType>::const_pointer start = &text.front();
-  for (const char &c : text) {
-    if (c == ' ') {
-      if (start != &c) {
-        words.push_back(StringType{start, size_t(&c - start)});
-      }
-      start = &c + 1;
+  for (const std::string_view token : tokens) {
+    if (!token.empty()) {
+      words.emplace_back(token);
     }
   }
-  if (start != &*text.end()) {
-    words.push_back(StringType{start, size_t(&*text.end() - start)});
-  }
-
   return words;
 }
 
@@ -38,4 +49,4 @@ MakeUniqueNonEmptyStrings(const StringContainer &strings) {
     }
   }
   return non_empty_strings;
-}
\ No newline at end of file
+}
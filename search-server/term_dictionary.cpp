@@ -0,0 +1,82 @@
+#include "term_dictionary.h"
+
+TermId TermDictionary::Intern(std::string_view word) {
+  const auto it = ids_.find(word);
+  if (it != ids_.end()) {
+    return it->second;
+  }
+  TermId term;
+  if (free_terms_.empty()) {
+    term = static_cast<TermId>(words_.size());
+    // Keys point into words_, deque never moves its elements on push_back
+    words_.emplace_back(word);
+    references_.push_back(0);
+  } else {
+    term = free_terms_.back();
+    free_terms_.pop_back();
+    words_[term] = word;
+  }
+  ids_.emplace(words_[term], term);
+  bytes_live_ += word.size();
+  return term;
+}
+
+void TermDictionary::AddReference(TermId term, uint32_t count) {
+  references_[term] += count;
+}
+
+bool TermDictionary::Release(TermId term) {
+  if (--references_[term] > 0) {
+    return false;
+  }
+  std::string &word = words_[term];
+  ids_.erase(word);
+  bytes_live_ -= word.size();
+  // Swapping with an empty string actually returns the buffer
+  std::string().swap(word);
+  free_terms_.push_back(term);
+  return true;
+}
+
+bool TermDictionary::Append(std::string_view word, uint32_t references) {
+  const TermId term = static_cast<TermId>(words_.size());
+  if (references == 0) {
+    words_.emplace_back();
+    references_.push_back(0);
+    free_terms_.push_back(term);
+    return true;
+  }
+  if (ids_.count(word) > 0) {
+    return false;
+  }
+  words_.emplace_back(word);
+  references_.push_back(references);
+  ids_.emplace(words_.back(), term);
+  bytes_live_ += word.size();
+  return true;
+}
+
+TermId TermDictionary::Find(std::string_view word) const {
+  const auto it = ids_.find(word);
+  return it == ids_.end() ? NO_TERM : it->second;
+}
+
+std::string_view TermDictionary::GetWord(TermId term) const {
+  return words_[term];
+}
+
+size_t TermDictionary::size() const { return words_.size(); }
+
+size_t TermDictionary::GetBytesHeld() const {
+  static const size_t inline_capacity = std::string().capacity();
+  size_t bytes = words_.size() * (sizeof(std::string) + sizeof(uint32_t)) +
+                 free_terms_.capacity() * sizeof(TermId);
+  for (const std::string &word : words_) {
+    if (word.capacity() > inline_capacity) {
+      bytes += word.capacity() + 1;
+    }
+  }
+  return bytes;
+}
+
+size_t TermDictionary::GetBytesLive() const { return bytes_live_; }
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Dense id of a distinct word
+using TermId = uint32_t;
+
+// Interns every distinct word once and gives it a TermId. The dictionary owns
+// the bytes of the words and counts references to them: when the last
+// reference is released the word is forgotten, its bytes are freed and its id
+// is given to the next new word. string_views returned by the dictionary stay
+// valid while the word is referenced.
+class TermDictionary {
+public:
+  static const TermId NO_TERM = UINT32_MAX;
+
+  // Returns id of the word, adding the word if it's new. A new word has no
+  // references, the caller is expected to add one
+  TermId Intern(std::string_view word);
+  void AddReference(TermId term, uint32_t count = 1);
+  // Returns true if it was the last reference and the word was forgotten
+  bool Release(TermId term);
+  // Gives the next id to the word with the given number of references, no
+  // references mean a free id. Restores a saved dictionary id by id.
+  // Returns false and adds nothing if the word is already there
+  bool Append(std::string_view word, uint32_t references);
+
+  // Returns NO_TERM for words the dictionary doesn't know
+  TermId Find(std::string_view word) const;
+  std::string_view GetWord(TermId term) const;
+
+  // Upper bound of the ids given out so far
+  size_t size() const;
+
+  // Bytes allocated for the words, including freed slots waiting for reuse
+  size_t GetBytesHeld() const;
+  // Bytes of the words currently in the dictionary
+  size_t GetBytesLive() const;
+
+private:
+  std::deque<std::string> words_;      // index - TermId
+  std::vector<uint32_t> references_;   // index - TermId
+  std::vector<TermId> free_terms_;
+  std::unordered_map<std::string_view, TermId> ids_;
+  size_t bytes_live_ = 0;
+};
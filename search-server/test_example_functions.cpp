@@ -1,6 +1,20 @@
 
 
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
 #include "test_example_functions.h"
+#include "corpus_loader.h"
+#include "duplicate_detector.h"
+#include "paginator.h"
+#include "process_queries.h"
+#include "search_cursor.h"
+#include "snapshot_format.h"
 
 void TestAddedDocumentContent() {
   const int doc_id = 42;
@@ -219,6 +233,1549 @@ void TestExcludeStopWordsFromAddedDocumentContent() {
               "Stop words must be excluded from documents");
 }
 
+void TestRemoveAndAddDocumentAgain() {
+  SearchServer server{std::string{""}};
+  server.AddDocument(1, "cat in the city", DocumentStatus::ACTUAL, {1});
+  server.AddDocument(2, "dog in the city", DocumentStatus::ACTUAL, {2});
+  server.RemoveDocument(1);
+  ASSERT_EQUAL(server.GetDocumentCount(), 1);
+  ASSERT_HINT(server.FindTopDocuments("cat").empty(),
+              "Removed document must not be found");
+
+  server.AddDocument(1, "cat in the house", DocumentStatus::ACTUAL, {3});
+  const auto found_docs = server.FindTopDocuments("cat house -dog");
+  ASSERT_EQUAL(found_docs.size(), 1);
+  ASSERT_EQUAL(found_docs[0].id, 1);
+  ASSERT_EQUAL(found_docs[0].rating, 3);
+  const auto [words, status] = server.MatchDocument("cat house", 1);
+  ASSERT_EQUAL(words, (std::vector<std::string_view>{"cat", "house"}));
+}
+
+void TestFindTopDocumentsResultCount() {
+  SearchServer server{std::string{""}};
+  for (int id = 0; id < 8; ++id) {
+    server.AddDocument(id, "cat" + std::string(id + 1, 'x') + " cat dog",
+                       DocumentStatus::ACTUAL, {id % 3});
+  }
+  const auto all_docs = server.FindTopDocuments(
+      std::execution::seq, "cat", [](auto...) { return true; }, 100);
+  ASSERT_EQUAL(all_docs.size(), 8);
+  ASSERT_EQUAL(server.FindTopDocuments("cat").size(),
+               MAX_RESULT_DOCUMENT_COUNT);
+  for (const size_t result_count : {0, 1, 3, 8}) {
+    for (const auto &found_docs :
+         {server.FindTopDocuments(std::execution::seq, "cat",
+                                  DocumentStatus::ACTUAL, result_count),
+          server.FindTopDocuments(std::execution::par, "cat",
+                                  DocumentStatus::ACTUAL, result_count)}) {
+      ASSERT_EQUAL(found_docs.size(), result_count);
+      for (size_t i = 0; i < result_count; ++i) {
+        ASSERT_EQUAL(found_docs[i].id, all_docs[i].id);
+      }
+    }
+  }
+}
+
+void TestFindTopDocumentsPages() {
+  SearchServer server{std::string{""}};
+  for (int id = 0; id < 11; ++id) {
+    server.AddDocument(id, "cat" + std::string(id + 1, 'x') + " cat dog",
+                       DocumentStatus::ACTUAL, {id % 4});
+  }
+  const auto all_docs = server.FindTopDocuments(
+      std::execution::seq, "cat", DocumentStatus::ACTUAL, 100);
+  ASSERT_EQUAL(all_docs.size(), 11);
+
+  const auto page = server.FindTopDocuments(std::execution::par, "cat",
+                                            DocumentStatus::ACTUAL, 4, 3);
+  ASSERT_EQUAL(page.size(), 3);
+  ASSERT_EQUAL(page[0].id, all_docs[4].id);
+  ASSERT_EQUAL(page[2].id, all_docs[6].id);
+  ASSERT_HINT(server
+                  .FindTopDocuments(std::execution::seq, "cat",
+                                    DocumentStatus::ACTUAL, 20, 3)
+                  .empty(),
+              "Page past the last result must be empty");
+
+  SearchCursor cursor(
+      server, "cat",
+      [](int, DocumentStatus status, int) {
+        return status == DocumentStatus::ACTUAL;
+      },
+      3);
+  std::vector<Document> cursor_docs;
+  while (cursor.HasMore()) {
+    const auto next_page = cursor.NextPage();
+    ASSERT(!next_page.empty() && next_page.size() <= 3);
+    cursor_docs.insert(cursor_docs.end(), next_page.begin(), next_page.end());
+  }
+  ASSERT(cursor.NextPage().empty());
+  ASSERT_EQUAL(cursor.GetOffset(), all_docs.size());
+  ASSERT_EQUAL(cursor_docs.size(), all_docs.size());
+  for (size_t i = 0; i < all_docs.size(); ++i) {
+    ASSERT_EQUAL(cursor_docs[i].id, all_docs[i].id);
+  }
+
+  size_t page_count = 0;
+  for (const auto &documents_page : Paginate(all_docs, 5)) {
+    ASSERT_EQUAL(documents_page.begin()->id, all_docs[page_count * 5].id);
+    ASSERT_EQUAL(documents_page.size(), page_count < 2 ? 5 : 1);
+    ++page_count;
+  }
+  ASSERT_EQUAL(page_count, 3);
+}
+
+void TestParallelSearchMatchesSequential() {
+  SearchServer server{std::string{"and"}};
+  const std::vector<std::string> words = {"cat", "dog",  "rat", "curly",
+                                          "pet", "nasty", "hair"};
+  for (int id = 0; id < 20'000; ++id) {
+    std::string text;
+    for (size_t i = 0; i < words.size(); ++i) {
+      if ((id * 7 + i * 13) % (i + 2) == 0) {
+        text += words[i] + std::string(id % 3 + 1, ' ') + "and ";
+      }
+    }
+    server.AddDocument(id, text + std::to_string(id % 100),
+                       DocumentStatus::ACTUAL, {id % 17, id % 5});
+  }
+  server.SetScoringConcurrency(4);
+  const auto predicate = [](int document_id, DocumentStatus, int rating) {
+    return document_id % 3 != 0 && rating > 2;
+  };
+  for (const std::string query : {"cat dog -rat", "curly pet hair", "7 -and"}) {
+    const auto sequential =
+        server.FindTopDocuments(std::execution::seq, query, predicate, 50);
+    const auto parallel =
+        server.FindTopDocuments(std::execution::par, query, predicate, 50);
+    ASSERT_EQUAL(sequential.size(), parallel.size());
+    for (size_t i = 0; i < sequential.size(); ++i) {
+      ASSERT_EQUAL(sequential[i].id, parallel[i].id);
+      ASSERT(std::abs(sequential[i].relevance - parallel[i].relevance) < 1e-9);
+    }
+  }
+}
+
+void TestWorkStealingPool() {
+  WorkStealingPool pool(3);
+  ASSERT_EQUAL(pool.GetConcurrency(), 4);
+  std::vector<std::atomic<int>> calls(100);
+  // Nested calls must not deadlock, the waiting thread runs tasks itself
+  pool.ParallelFor(10, [&](size_t outer) {
+    pool.ParallelFor(10, [&](size_t inner) { ++calls[outer * 10 + inner]; });
+  });
+  ASSERT(std::all_of(calls.begin(), calls.end(),
+                     [](const std::atomic<int> &count) { return count == 1; }));
+
+  // An exception of a task reaches the caller, the pool keeps working
+  for (int attempt = 0; attempt < 20; ++attempt) {
+    try {
+      pool.ParallelFor(50, [](size_t i) {
+        if (i % 7 == 3) {
+          throw std::runtime_error("task " + std::to_string(i));
+        }
+      });
+      ASSERT_HINT(false, "The exception of a task must be rethrown");
+    } catch (const std::runtime_error &) {
+    }
+  }
+  std::atomic<int> total = 0;
+  pool.ParallelFor(100, [&total](size_t) { ++total; });
+  ASSERT_EQUAL(total.load(), 100);
+}
+
+void TestWordFrequenciesAndUnknownWords() {
+  SearchServer server{std::string{"the"}};
+  server.AddDocument(1, "zebra cat the cat", DocumentStatus::ACTUAL, {1});
+  const auto word_freqs = server.GetWordFrequencies(1);
+  ASSERT_EQUAL(word_freqs.size(), 2);
+  ASSERT(std::abs(word_freqs.at("cat") - 2.0 / 3) < 1e-9);
+  ASSERT(std::abs(word_freqs.at("zebra") - 1.0 / 3) < 1e-9);
+  ASSERT(server.GetWordFrequencies(2).empty());
+
+  // Words missing from the index neither match nor exclude anything
+  ASSERT_EQUAL(server.FindTopDocuments("cat unicorn -dragon").size(), 1);
+  const auto [words, status] = server.MatchDocument("zebra cat owl -dog", 1);
+  ASSERT_EQUAL(words, (std::vector<std::string_view>{"cat", "zebra"}));
+  const auto [par_words, par_status] =
+      server.MatchDocument(std::execution::par, "zebra the cat", 1);
+  ASSERT_EQUAL(par_words, (std::vector<std::string_view>{"cat", "zebra"}));
+}
+
+void TestRemovedDocumentsFreeWords() {
+  SearchServer server{std::string{"the"}};
+  server.AddDocument(1, "the cat", DocumentStatus::ACTUAL, {1});
+  const auto baseline = server.GetStorageStats();
+  // Churning through documents with unique long words
+  for (int id = 2; id < 100; ++id) {
+    const std::string word = "unique_long_word_" + std::to_string(id);
+    server.AddDocument(id, "cat " + word, DocumentStatus::ACTUAL, {1});
+    ASSERT_EQUAL(server.FindTopDocuments(word).size(), 1);
+    if (id % 2 == 0) {
+      server.RemoveDocument(id);
+    } else {
+      server.RemoveDocument(std::execution::par, id);
+    }
+    ASSERT(server.FindTopDocuments(word).empty());
+  }
+  const auto stats = server.GetStorageStats();
+  ASSERT_EQUAL(stats.word_bytes_live, baseline.word_bytes_live);
+  ASSERT_EQUAL(stats.posting_bytes_live, baseline.posting_bytes_live);
+  // Freed term slots are reused instead of growing the dictionary
+  ASSERT(stats.word_bytes_held <= baseline.word_bytes_held + 64);
+
+  // Stop words and words of live documents survive removals
+  server.AddDocument(100, "the dog", DocumentStatus::ACTUAL, {1});
+  server.RemoveDocument(100);
+  ASSERT(server.FindTopDocuments("the").empty());
+  ASSERT_EQUAL(server.FindTopDocuments("cat").size(), 1);
+  ASSERT_EQUAL(server.GetWordFrequencies(1).count("cat"), 1);
+}
+
+void TestRemoveDocumentsBatch() {
+  SearchServer one_by_one{std::string{"and"}};
+  SearchServer batch_seq{std::string{"and"}};
+  SearchServer batch_par{std::string{"and"}};
+  const std::vector<std::string> words{"cat", "dog", "owl", "fox", "eel"};
+  for (int id = 0; id < 300; ++id) {
+    const std::string text = words[id % 5] + " and " + words[id % 3] + " " +
+                             words[id % 7 % 5] + " id" + std::to_string(id);
+    for (SearchServer *server : {&one_by_one, &batch_seq, &batch_par}) {
+      server->AddDocument(id, text, DocumentStatus::ACTUAL, {id % 10});
+    }
+  }
+  std::vector<int> removed{-5, 1000};
+  for (int id = 0; id < 300; id += 3) {
+    removed.push_back(id);
+    removed.push_back(id);
+    one_by_one.RemoveDocument(id);
+  }
+  batch_seq.RemoveDocuments(removed);
+  batch_par.RemoveDocuments(std::execution::par, removed);
+
+  for (const SearchServer *server : {&batch_seq, &batch_par}) {
+    ASSERT_EQUAL(server->GetDocumentCount(), 200);
+    ASSERT(server->FindTopDocuments("id3").empty());
+    ASSERT_EQUAL(server->FindTopDocuments("id4").size(), 1);
+    for (const std::string &word : words) {
+      const auto expected = one_by_one.FindTopDocuments(
+          std::execution::seq, word, DocumentStatus::ACTUAL, 500);
+      const auto actual = server->FindTopDocuments(
+          std::execution::seq, word, DocumentStatus::ACTUAL, 500);
+      ASSERT_EQUAL(actual.size(), expected.size());
+      for (size_t i = 0; i < actual.size(); ++i) {
+        ASSERT_EQUAL(actual[i].id, expected[i].id);
+      }
+    }
+    const auto stats = server->GetStorageStats();
+    const auto expected_stats = one_by_one.GetStorageStats();
+    ASSERT_EQUAL(stats.word_bytes_live, expected_stats.word_bytes_live);
+    ASSERT_EQUAL(stats.posting_bytes_live, expected_stats.posting_bytes_live);
+  }
+}
+
+void TestSoftDeleteWithBackgroundCompaction() {
+  SearchServer hard{std::string{"and"}};
+  SearchServer soft{std::string{"and"}};
+  soft.SetSoftDelete(true);
+  const std::vector<std::string> words{"cat", "dog", "owl", "fox", "eel"};
+  for (int id = 0; id < 2000; ++id) {
+    const std::string text = words[id % 5] + " and " + words[id % 3] + " id" +
+                             std::to_string(id);
+    hard.AddDocument(id, text, DocumentStatus::ACTUAL, {id % 10});
+    soft.AddDocument(id, text, DocumentStatus::ACTUAL, {id % 10});
+  }
+  const auto expect_same_results = [&]() {
+    for (const std::string &word : words) {
+      const auto expected = hard.FindTopDocuments(
+          std::execution::seq, word, DocumentStatus::ACTUAL, 3000);
+      const auto actual = soft.FindTopDocuments(
+          std::execution::par, word, DocumentStatus::ACTUAL, 3000);
+      ASSERT_EQUAL(actual.size(), expected.size());
+      for (size_t i = 0; i < actual.size(); ++i) {
+        ASSERT_EQUAL(actual[i].id, expected[i].id);
+        ASSERT(std::abs(actual[i].relevance - expected[i].relevance) < 1e-9);
+      }
+    }
+  };
+
+  // Queries run while the compactor rewrites posting lists
+  std::atomic<bool> removing = true;
+  std::thread reader([&]() {
+    while (removing) {
+      ASSERT(soft.FindTopDocuments(std::execution::par, "cat dog").size() <=
+             MAX_RESULT_DOCUMENT_COUNT);
+    }
+  });
+  std::vector<int> batch;
+  for (int id = 0; id < 2000; id += 2) {
+    hard.RemoveDocument(id);
+    if (id % 4 == 0) {
+      soft.RemoveDocument(id);
+    } else {
+      batch.push_back(id);
+    }
+  }
+  soft.RemoveDocuments(std::execution::par, batch);
+  // Removed documents disappear at once, before any compaction
+  ASSERT_EQUAL(soft.GetDocumentCount(), 1000);
+  ASSERT(soft.FindTopDocuments("id0").empty());
+  expect_same_results();
+  soft.WaitForCompaction();
+  removing = false;
+  reader.join();
+
+  expect_same_results();
+  const auto stats = soft.GetStorageStats();
+  const auto expected_stats = hard.GetStorageStats();
+  ASSERT_EQUAL(stats.word_bytes_live, expected_stats.word_bytes_live);
+  ASSERT_EQUAL(stats.posting_bytes_live, expected_stats.posting_bytes_live);
+  ASSERT(stats.posting_bytes_held <= stats.posting_bytes_live * 4);
+}
+
+void TestFindDuplicates() {
+  SearchServer server{std::string{"and with"}};
+  const std::vector<std::pair<int, std::string>> documents{
+      {1, "funny pet and nasty rat"},
+      {2, "funny pet with curly hair"},
+      {3, "funny pet with curly hair"},
+      {4, "funny pet and curly hair"},
+      {5, "funny funny pet and nasty nasty rat"},
+      {6, "funny pet and not very nasty rat"},
+      {7, "very nasty rat and not very funny pet"},
+      {8, "pet with rat and rat and rat"},
+      {9, "nasty rat with curly hair"},
+      {10, "nasty rat with curly hair and bald tail"},
+  };
+  for (const auto &[id, text] : documents) {
+    server.AddDocument(id, text, DocumentStatus::ACTUAL, {1, 2});
+  }
+  ASSERT_EQUAL(FindDuplicates(server), (std::vector<int>{3, 4, 5, 7}));
+  // Both 6 to 1 and 10 to 9 have 4 common words out of 6
+  ASSERT_EQUAL(FindDuplicates(server, 0.6),
+               (std::vector<int>{3, 4, 5, 6, 7, 10}));
+  ASSERT_EQUAL(FindDuplicates(server, 0.7), (std::vector<int>{3, 4, 5, 7}));
+
+  RemoveDuplicates(server, true, 0.6);
+  ASSERT_EQUAL(server.GetDocumentCount(), 4);
+  ASSERT(server.FindTopDocuments("tail").empty());
+  ASSERT_EQUAL(server.FindTopDocuments("hair").size(), 2);
+}
+
+void TestSnapshotSaveAndLoad() {
+  const std::string path =
+      (std::filesystem::temp_directory_path() / "search_server_test.snapshot")
+          .string();
+  SearchServer original{std::string{"and with"}};
+  original.AddDocument(1, "funny pet and nasty rat", DocumentStatus::ACTUAL,
+                       {7, 2, 7});
+  original.AddDocument(2, "funny pet with curly hair", DocumentStatus::ACTUAL,
+                       {1, 2});
+  original.AddDocument(3, "big dog and rat", DocumentStatus::BANNED, {5});
+  original.AddDocument(4, "lonely word", DocumentStatus::ACTUAL, {});
+  original.AddDocument(5, "nasty curly dog", DocumentStatus::ACTUAL, {3});
+  original.RemoveDocument(4);
+  original.SetSoftDelete(true);
+  original.RemoveDocument(5);
+  original.SaveSnapshot(path);
+
+  SearchServer loaded{std::string{"unused stop words"}};
+  loaded.AddDocument(9, "to be replaced", DocumentStatus::ACTUAL, {1});
+  loaded.LoadSnapshot(path);
+  ASSERT_EQUAL(loaded.GetDocumentCount(), 3);
+  ASSERT(loaded.GetStorageStats().snapshot_bytes_mapped > 0);
+  const auto expect_same_results = [&](const std::string &query) {
+    const auto expected = original.FindTopDocuments(query);
+    const auto actual = loaded.FindTopDocuments(query);
+    ASSERT_EQUAL(actual.size(), expected.size());
+    for (size_t i = 0; i < actual.size(); ++i) {
+      ASSERT_EQUAL(actual[i].id, expected[i].id);
+      ASSERT_EQUAL(actual[i].rating, expected[i].rating);
+      ASSERT(std::abs(actual[i].relevance - expected[i].relevance) < 1e-9);
+    }
+  };
+  for (const std::string query :
+       {"funny rat", "curly -funny", "dog", "and", "lonely", "replaced"}) {
+    expect_same_results(query);
+  }
+  ASSERT_EQUAL(loaded.FindTopDocuments("dog", DocumentStatus::BANNED).size(),
+               1);
+  const auto [words, status] = loaded.MatchDocument("nasty rat -dog", 1);
+  ASSERT_EQUAL(words, (std::vector<std::string_view>{"nasty", "rat"}));
+  ASSERT_EQUAL(loaded.GetWordFrequencies(2).size(), 4);
+
+  // Mapped lists are copied on modification
+  for (SearchServer *server : {&original, &loaded}) {
+    server->AddDocument(6, "funny curly rat", DocumentStatus::ACTUAL, {4});
+    server->AddDocument(7, "lonely new word", DocumentStatus::ACTUAL, {4});
+    server->RemoveDocument(std::execution::seq, 2);
+  }
+  original.WaitForCompaction();
+  for (const std::string query : {"funny rat", "curly", "lonely", "new"}) {
+    expect_same_results(query);
+  }
+
+  {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << "not a snapshot at all, just some text";
+  }
+  try {
+    loaded.LoadSnapshot(path);
+    ASSERT_HINT(false, "Loading a broken snapshot must throw");
+  } catch (const std::invalid_argument &) {
+  }
+  // A failed load leaves the server as it was
+  ASSERT_EQUAL(loaded.GetDocumentCount(), 4);
+
+  // Snapshots with terms out of range or order, repeated document ids,
+  // words or wrong reference counts are rejected too
+  original.SaveSnapshot(path);
+  std::string bytes;
+  {
+    std::ifstream in(path, std::ios::binary);
+    bytes.assign(std::istreambuf_iterator<char>(in), {});
+  }
+  SnapshotHeader header;
+  std::memcpy(&header, bytes.data(), sizeof(header));
+  ASSERT(header.document_count >= 2);
+  const auto expect_broken_rejected = [&](const std::string &broken) {
+    {
+      std::ofstream out(path, std::ios::binary | std::ios::trunc);
+      out << broken;
+    }
+    try {
+      loaded.LoadSnapshot(path);
+      ASSERT_HINT(false, "Loading a broken snapshot must throw");
+    } catch (const std::invalid_argument &) {
+    }
+    ASSERT_EQUAL(loaded.GetDocumentCount(), 4);
+  };
+  const auto expect_rejected = [&](size_t offset, uint32_t value) {
+    std::string broken = bytes;
+    std::memcpy(broken.data() + offset, &value, sizeof(value));
+    expect_broken_rejected(broken);
+  };
+  SnapshotDocument first_document;
+  std::memcpy(&first_document, bytes.data() + header.documents_offset,
+              sizeof(first_document));
+  ASSERT(first_document.term_count >= 2);
+  // Terms of a document are (TermId, TF) pairs of 16 bytes
+  expect_rejected(header.document_terms_offset +
+                      16 * (first_document.term_count - 1),
+                  header.term_count);
+  expect_rejected(header.document_terms_offset + 16, 0);
+  // TFs follow the ids, the high half of a NaN or of 2.0
+  expect_rejected(header.document_terms_offset + 12, 0x7ff80000);
+  expect_rejected(header.document_terms_offset + 12, 0x40000000);
+  expect_rejected(header.documents_offset + sizeof(SnapshotDocument),
+                  static_cast<uint32_t>(first_document.id));
+  SnapshotTerm first_term;
+  std::memcpy(&first_term, bytes.data() + header.terms_offset,
+              sizeof(first_term));
+  ASSERT(header.term_count >= 2 && first_term.references > 0);
+  const size_t references_offset =
+      header.terms_offset + offsetof(SnapshotTerm, references);
+  expect_rejected(references_offset, 0);
+  expect_rejected(references_offset, first_term.references + 1);
+  // The second term gets the word of the first one
+  std::string duplicate_word = bytes;
+  SnapshotTerm second_term;
+  std::memcpy(&second_term,
+              bytes.data() + header.terms_offset + sizeof(SnapshotTerm),
+              sizeof(second_term));
+  ASSERT(second_term.references > 0);
+  second_term.word_offset = first_term.word_offset;
+  second_term.word_size = first_term.word_size;
+  std::memcpy(duplicate_word.data() + header.terms_offset +
+                  sizeof(SnapshotTerm),
+              &second_term, sizeof(second_term));
+  expect_broken_rejected(duplicate_word);
+
+  // Concurrent saves to one path leave one complete snapshot
+  std::vector<std::thread> savers;
+  for (int i = 0; i < 4; ++i) {
+    savers.emplace_back([&original, &path] {
+      for (int j = 0; j < 10; ++j) {
+        original.SaveSnapshot(path);
+      }
+    });
+  }
+  for (std::thread &saver : savers) {
+    saver.join();
+  }
+  loaded.LoadSnapshot(path);
+  for (const std::string query : {"funny rat", "curly", "lonely", "new"}) {
+    expect_same_results(query);
+  }
+  std::remove(path.c_str());
+}
+
+void TestMutationLogReplay() {
+  const auto temp_dir = std::filesystem::temp_directory_path();
+  const std::string snapshot_path =
+      (temp_dir / "search_server_test_wal.snapshot").string();
+  const std::string log_path = (temp_dir / "search_server_test.wal").string();
+  std::remove(log_path.c_str());
+
+  SearchServer original{std::string{"and"}};
+  {
+    auto log = std::make_shared<MutationLog>(log_path);
+    original.SetMutationLog(log);
+    original.AddDocument(1, "white cat and collar", DocumentStatus::ACTUAL,
+                         {8, -3});
+    original.AddDocument(2, "fluffy cat fluffy tail", DocumentStatus::ACTUAL,
+                         {7, 2, 7});
+    original.SaveSnapshot(snapshot_path);
+    original.AddDocument(3, "groomed dog expressive eyes",
+                         DocumentStatus::BANNED, {5, -12, 2, 1});
+    original.RemoveDocument(1);
+    original.AddDocument(1, "new cat", DocumentStatus::ACTUAL, {3});
+    original.RemoveDocuments(std::execution::par, {2, 42});
+    original.SetMutationLog(nullptr);
+  }
+
+  // Restart: the snapshot and the records logged after it
+  const auto restore = [&]() {
+    auto restored = std::make_unique<SearchServer>(std::string{});
+    restored->LoadSnapshot(snapshot_path);
+    MutationLog::Replay(log_path, *restored);
+    return restored;
+  };
+  const auto expect_same = [&](const SearchServer &restored) {
+    ASSERT_EQUAL(restored.GetDocumentCount(), original.GetDocumentCount());
+    for (const std::string query : {"cat", "fluffy", "dog", "white", "new"}) {
+      for (const auto status : {DocumentStatus::ACTUAL,
+                                DocumentStatus::BANNED}) {
+        const auto expected = original.FindTopDocuments(query, status);
+        const auto actual = restored.FindTopDocuments(query, status);
+        ASSERT_EQUAL(actual.size(), expected.size());
+        for (size_t i = 0; i < actual.size(); ++i) {
+          ASSERT_EQUAL(actual[i].id, expected[i].id);
+          ASSERT_EQUAL(actual[i].rating, expected[i].rating);
+        }
+      }
+    }
+  };
+  expect_same(*restore());
+
+  // A crash in the middle of a write leaves a torn record at the end
+  {
+    std::ofstream out(log_path, std::ios::binary | std::ios::app);
+    out.write("\x20\x00\x00\x00torn", 8);
+  }
+  expect_same(*restore());
+
+  // Batched and timed durability lose nothing on Sync
+  for (const auto durability :
+       {LogDurability::EVERY_BATCH, LogDurability::TIMER}) {
+    std::remove(log_path.c_str());
+    MutationLogOptions options;
+    options.durability = durability;
+    options.batch_size = 4;
+    options.sync_interval = std::chrono::milliseconds(10);
+    auto log = std::make_shared<MutationLog>(log_path, options);
+    SearchServer server{std::string{}};
+    server.SetMutationLog(log);
+    for (int id = 0; id < 10; ++id) {
+      server.AddDocument(id, "word" + std::to_string(id),
+                         DocumentStatus::ACTUAL, {id});
+    }
+    server.RemoveDocument(3);
+    log->Sync();
+    SearchServer replayed{std::string{}};
+    ASSERT_EQUAL(MutationLog::Replay(log_path, replayed), 11);
+    ASSERT_EQUAL(replayed.GetDocumentCount(), 9);
+    ASSERT(replayed.FindTopDocuments("word3").empty());
+  }
+
+  // A record of an unknown status ends the replay like a corrupted one
+  std::remove(log_path.c_str());
+  {
+    MutationLog log(log_path);
+    log.LogAddDocument(1, "valid", DocumentStatus::BANNED, {1});
+    log.LogAddDocument(2, "unknown status", static_cast<DocumentStatus>(9),
+                       {1});
+    log.LogAddDocument(3, "after it", DocumentStatus::ACTUAL, {1});
+  }
+  SearchServer replayed{std::string{}};
+  ASSERT_EQUAL(MutationLog::Replay(log_path, replayed), 1);
+  ASSERT_EQUAL(replayed.GetDocumentCount(), 1);
+  std::remove(log_path.c_str());
+  std::remove(snapshot_path.c_str());
+}
+
+void TestAddDocumentsBatch() {
+  const std::vector<std::string> words{"cat", "dog", "owl", "fox", "eel"};
+  std::vector<std::string> texts;
+  std::vector<NewDocument> documents;
+  for (int id = 0; id < 3000; ++id) {
+    texts.push_back(words[id % 5] + " and " + words[id % 3] + " " +
+                    words[id % 7 % 5] + " id" + std::to_string(id % 500));
+  }
+  for (int id = 0; id < 3000; ++id) {
+    documents.push_back({id, texts[id], DocumentStatus::ACTUAL, {id % 10}});
+  }
+
+  SearchServer one_by_one{std::string{"and"}};
+  one_by_one.AddDocument(5000, "cat id1", DocumentStatus::ACTUAL, {1});
+  for (const NewDocument &document : documents) {
+    one_by_one.AddDocument(document.id, document.text, document.status,
+                           document.ratings);
+  }
+  SearchServer batch_seq{std::string{"and"}};
+  SearchServer batch_par{std::string{"and"}};
+  for (SearchServer *server : {&batch_seq, &batch_par}) {
+    server->AddDocument(5000, "cat id1", DocumentStatus::ACTUAL, {1});
+  }
+  batch_seq.AddDocuments(documents);
+  batch_par.AddDocuments(std::execution::par, documents);
+
+  for (const SearchServer *server : {&batch_seq, &batch_par}) {
+    ASSERT_EQUAL(server->GetDocumentCount(), 3001);
+    for (const std::string query : {"cat", "dog -owl", "id1", "fox id42"}) {
+      const auto expected = one_by_one.FindTopDocuments(
+          std::execution::seq, query, DocumentStatus::ACTUAL, 5000);
+      const auto actual = server->FindTopDocuments(
+          std::execution::seq, query, DocumentStatus::ACTUAL, 5000);
+      ASSERT_EQUAL(actual.size(), expected.size());
+      for (size_t i = 0; i < actual.size(); ++i) {
+        ASSERT_EQUAL(actual[i].id, expected[i].id);
+        ASSERT(std::abs(actual[i].relevance - expected[i].relevance) < 1e-9);
+      }
+    }
+    const auto [matched, status] = server->MatchDocument("owl dog cat eel", 7);
+    ASSERT_EQUAL(matched.size(), 3u);
+  }
+
+  // A bad document fails the whole batch
+  const auto actual = DocumentStatus::ACTUAL;
+  const std::vector<std::vector<NewDocument>> bad_batches{
+      {{1, "new cat", actual, {}},
+       {2, "new dog", actual, {}},
+       {1, "new owl", actual, {}}},
+      {{6000, "new cat", actual, {}}, {5000, "new dog", actual, {}}},
+      {{6000, "new cat", actual, {}}, {6001, "new d\x12og", actual, {}}},
+      {{6000, "new cat", actual, {}}, {-1, "new dog", actual, {}}},
+  };
+  for (const auto &batch : bad_batches) {
+    for (SearchServer *server : {&batch_seq, &batch_par}) {
+      try {
+        server->AddDocuments(std::execution::par, batch);
+        ASSERT_HINT(false, "Bad batch must throw");
+      } catch (const std::invalid_argument &) {
+      }
+      ASSERT_EQUAL(server->GetDocumentCount(), 3001);
+      ASSERT(server->FindTopDocuments("new").empty());
+    }
+  }
+}
+
+void TestConcurrentQueriesAndUpdates() {
+  const int stable_count = 50;
+  for (const bool soft_delete : {false, true}) {
+    SearchServer server{std::string{"and"}};
+    server.SetSoftDelete(soft_delete);
+    server.SetScoringConcurrency(3);
+    // Writers seal segments often, so the merger runs under the queries
+    server.SetWriteBufferSize(256);
+    for (int id = 0; id < stable_count; ++id) {
+      server.AddDocument(id, "stable and cat" + std::to_string(id % 5),
+                         DocumentStatus::ACTUAL, {id});
+    }
+
+    std::atomic<int> writers_left = 2;
+    std::atomic<bool> failed = false;
+    const auto check = [&failed](bool condition) {
+      if (!condition) {
+        failed = true;
+      }
+    };
+    std::vector<std::thread> threads;
+    for (int writer = 0; writer < 2; ++writer) {
+      threads.emplace_back([&, writer] {
+        const int base = 1000 + writer * 100'000;
+        for (int round = 0; round < 100; ++round) {
+          const int first = base + round * 10;
+          std::vector<NewDocument> batch;
+          const std::string text = "churn stable cat" + std::to_string(round);
+          for (int id = first; id < first + 5; ++id) {
+            batch.push_back({id, text, DocumentStatus::BANNED, {1}});
+          }
+          server.AddDocuments(std::execution::par, batch);
+          for (int id = first + 5; id < first + 10; ++id) {
+            server.AddDocument(id, "churn dog", DocumentStatus::BANNED, {2});
+          }
+          server.RemoveDocument(first + 5);
+          server.RemoveDocument(std::execution::par, first + 6);
+          server.RemoveDocuments(std::execution::par,
+                                 {first, first + 1, first + 2});
+        }
+        --writers_left;
+      });
+    }
+    for (int reader = 0; reader < 3; ++reader) {
+      threads.emplace_back([&, reader] {
+        while (writers_left > 0) {
+          const auto stable = [](int, DocumentStatus status, int) {
+            return status == DocumentStatus::ACTUAL;
+          };
+          // Modifications never touch the stable documents
+          const auto found =
+              reader % 2 == 0
+                  ? server.FindTopDocuments(std::execution::par,
+                                            "stable churn -dog", stable, 1000)
+                  : server.FindTopDocuments(std::execution::seq,
+                                            "stable cat1", stable, 1000);
+          check(found.size() == stable_count);
+          const auto churn = server.FindTopDocuments(
+              std::execution::par, "churn", DocumentStatus::BANNED, 1000);
+          for (const Document &document : churn) {
+            check(document.id >= 1000);
+            // The document may be gone by now
+            try {
+              const auto [words, status] =
+                  server.MatchDocument("churn stable", document.id);
+              check(!words.empty() && status == DocumentStatus::BANNED);
+            } catch (const std::out_of_range &) {
+            }
+            server.GetWordFrequencies(document.id);
+          }
+          check(server.GetDocumentCount() >= stable_count);
+          check(server.GetDocumentIds().size() >= stable_count);
+        }
+      });
+    }
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+    server.WaitForCompaction();
+    ASSERT(!failed);
+    ASSERT_EQUAL(server.GetDocumentCount(), stable_count + 2 * 100 * 5);
+    ASSERT_EQUAL(server.FindTopDocuments(std::execution::seq, "churn",
+                                         DocumentStatus::BANNED, 10'000)
+                     .size(),
+                 1000u);
+  }
+}
+
+void TestSegmentedIndex() {
+  const std::vector<std::string> words{"cat", "dog", "owl", "fox", "eel"};
+  SearchServer reference{std::string{"and"}};
+  SearchServer segmented{std::string{"and"}};
+  segmented.SetWriteBufferSize(64);
+  segmented.SetScoringConcurrency(4);
+  const auto add = [&](int id) {
+    const std::string text = words[id % 5] + " and " + words[id % 3] + " " +
+                             words[id % 7 % 5] + " id" + std::to_string(id);
+    for (SearchServer *server : {&reference, &segmented}) {
+      server->AddDocument(id, text, DocumentStatus::ACTUAL, {id % 10});
+    }
+  };
+  const auto expect_same_results = [&]() {
+    for (const std::string query :
+         {"cat", "dog owl", "fox -cat", "eel -id7 id8 id9", "cat dog owl"}) {
+      const auto expected = reference.FindTopDocuments(
+          std::execution::seq, query, DocumentStatus::ACTUAL, 10'000);
+      for (const auto &actual :
+           {segmented.FindTopDocuments(std::execution::seq, query,
+                                       DocumentStatus::ACTUAL, 10'000),
+            segmented.FindTopDocuments(std::execution::par, query,
+                                       DocumentStatus::ACTUAL, 10'000)}) {
+        ASSERT_EQUAL(actual.size(), expected.size());
+        for (size_t i = 0; i < actual.size(); ++i) {
+          ASSERT_EQUAL(actual[i].id, expected[i].id);
+          ASSERT(std::abs(actual[i].relevance - expected[i].relevance) <
+                 1e-9);
+        }
+      }
+    }
+  };
+
+  for (int id = 0; id < 3000; ++id) {
+    add(id);
+  }
+  // Queries see sealed and merging segments and the write buffer
+  expect_same_results();
+  segmented.WaitForMerges();
+  expect_same_results();
+  // Merges keep the number of segments logarithmic
+  ASSERT(segmented.GetSegmentCount() > 1);
+  ASSERT(segmented.GetSegmentCount() < 20);
+
+  // Removed documents stay in sealed segments until they are merged away
+  std::vector<int> removed;
+  for (int id = 0; id < 3000; ++id) {
+    if (id % 4 != 0) {
+      removed.push_back(id);
+    }
+  }
+  reference.RemoveDocuments(removed);
+  segmented.RemoveDocuments(std::execution::par,
+                            {removed.begin(), removed.begin() + 1000});
+  for (auto it = removed.begin() + 1000; it != removed.end(); ++it) {
+    segmented.RemoveDocument(*it);
+  }
+  expect_same_results();
+  segmented.WaitForMerges();
+  expect_same_results();
+  const auto stats = segmented.GetStorageStats();
+  ASSERT_EQUAL(stats.posting_bytes_live,
+               reference.GetStorageStats().posting_bytes_live);
+  ASSERT(stats.posting_bytes_held < stats.posting_bytes_live * 2);
+
+  // Snapshot of the segments and the buffer loads back as one segment
+  const std::string path =
+      (std::filesystem::temp_directory_path() / "search_server_segments.bin")
+          .string();
+  segmented.SaveSnapshot(path);
+  segmented.LoadSnapshot(path);
+  ASSERT_EQUAL(segmented.GetSegmentCount(), 1u);
+  expect_same_results();
+  for (int id = 3000; id < 3500; ++id) {
+    add(id);
+  }
+  expect_same_results();
+  std::remove(path.c_str());
+}
+
+void TestCompressedPostings() {
+  // Dense runs, single postings, gaps of every width and counts up to the
+  // largest one, in full blocks and in a partial last block
+  for (const size_t posting_count : {1, 127, 128, 129, 300, 1000}) {
+    std::vector<int> ordinals;
+    std::vector<uint32_t> counts;
+    std::vector<double> term_freqs;
+    int ordinal = 0;
+    for (size_t i = 0; i < posting_count; ++i) {
+      ordinal += i % 50 == 7 ? 1 << (i / 50 + 10)
+                             : 1 + static_cast<int>(i % 3);
+      ordinals.push_back(ordinal);
+      counts.push_back(i % 97 == 5 ? UINT32_MAX : 1 + i % 4);
+      term_freqs.push_back(1.0 / (1 + i % 200));
+    }
+    std::vector<uint32_t> data;
+    CompressedPostings::Encode(ordinals, counts, term_freqs, data);
+    const CompressedPostings postings(data.data(), posting_count);
+    ASSERT(CompressedPostings::Validate(data.data(), data.size(),
+                                        posting_count, 0, ordinal + 1));
+    ASSERT(!CompressedPostings::Validate(data.data(), data.size(),
+                                         posting_count, 0, ordinal));
+    ASSERT(!CompressedPostings::Validate(data.data(), data.size() - 1,
+                                         posting_count, 0, ordinal + 1));
+
+    std::vector<int> decoded_ordinals;
+    std::vector<uint32_t> decoded_counts;
+    postings.ForEach(0, ordinal + 1, [&](int ordinal, uint32_t count) {
+      decoded_ordinals.push_back(ordinal);
+      decoded_counts.push_back(count);
+    });
+    ASSERT(decoded_ordinals == ordinals);
+    ASSERT(decoded_counts == counts);
+    // TF bounds are rounded up to 255ths
+    const double max_term_freq =
+        *std::max_element(term_freqs.begin(), term_freqs.end());
+    ASSERT(postings.GetMaxTermFreq() >= max_term_freq);
+    ASSERT(postings.GetMaxTermFreq() <= max_term_freq + 1.0 / 255);
+
+    // A range in the middle skips the blocks around it
+    const int first = ordinals[posting_count / 3];
+    const int last = ordinals[posting_count * 2 / 3] + 1;
+    size_t in_range = 0;
+    postings.ForEach(first, last, [&](int ordinal, uint32_t) {
+      ASSERT(ordinal >= first && ordinal < last);
+      ++in_range;
+    });
+    ASSERT_EQUAL(in_range, posting_count * 2 / 3 - posting_count / 3 + 1);
+    size_t in_blocks = 0;
+    postings.ForEachBlock([&](int, size_t count) { in_blocks += count; });
+    ASSERT_EQUAL(in_blocks, posting_count);
+  }
+
+  // Consecutive ordinals occurring once take only the block headers
+  std::vector<int> dense_ordinals(200);
+  std::iota(dense_ordinals.begin(), dense_ordinals.end(), 10);
+  std::vector<uint32_t> data;
+  CompressedPostings::Encode(dense_ordinals, std::vector<uint32_t>(200, 1),
+                             std::vector<double>(200, 1), data);
+  ASSERT_EQUAL(data.size(), 6u);
+  std::vector<int> decoded_ordinals;
+  CompressedPostings(data.data(), 200)
+      .ForEach(0, 1000, [&](int ordinal, uint32_t count) {
+        ASSERT_EQUAL(count, 1u);
+        decoded_ordinals.push_back(ordinal);
+      });
+  ASSERT(decoded_ordinals == dense_ordinals);
+
+  // Segments score exactly like the write buffer, repeated words included,
+  // in a fraction of its memory
+  SearchServer buffered{std::string{"and"}};
+  SearchServer compressed{std::string{"and"}};
+  buffered.SetWriteBufferSize(1 << 20);
+  compressed.SetWriteBufferSize(256);
+  for (int id = 0; id < 5000; ++id) {
+    std::string text;
+    for (int i = 0; i < 12; ++i) {
+      text += "w" + std::to_string((id * 7 + i * i * 13) % (5 + i * 9)) + " ";
+    }
+    text += "and w" + std::to_string(id % 5);
+    for (SearchServer *server : {&buffered, &compressed}) {
+      server->AddDocument(id, text, DocumentStatus::ACTUAL, {id % 10});
+    }
+  }
+  compressed.WaitForMerges();
+  ASSERT(compressed.GetSegmentCount() > 0);
+  for (const std::string query : {"w1", "w3 w4 -w2", "w0 w7 w40 w90"}) {
+    const auto expected = buffered.FindTopDocuments(
+        std::execution::seq, query, DocumentStatus::ACTUAL, 10'000);
+    const auto actual = compressed.FindTopDocuments(
+        std::execution::par, query, DocumentStatus::ACTUAL, 10'000);
+    ASSERT_EQUAL(actual.size(), expected.size());
+    for (size_t i = 0; i < actual.size(); ++i) {
+      ASSERT_EQUAL(actual[i].id, expected[i].id);
+      ASSERT_EQUAL(actual[i].relevance, expected[i].relevance);
+    }
+  }
+  ASSERT(compressed.GetPostingsMemoryUsage() * 5 <
+         buffered.GetPostingsMemoryUsage());
+}
+
+void TestTokenizer() {
+  // Every kernel splits like the plain scan, with spaces and special
+  // characters at every position around the 16 and 32 byte chunks
+  const std::string alphabet = std::string("ab  \t\x1f\x7f\xd0") + '\0';
+  uint32_t seed = 1;
+  for (size_t length = 0; length < 100; ++length) {
+    for (int round = 0; round < 20; ++round) {
+      std::string text;
+      for (size_t i = 0; i < length; ++i) {
+        seed = seed * 1103515245 + 12345;
+        // Most texts are made of letters and spaces only
+        const size_t letters = round % 2 == 0 ? 4 : alphabet.size();
+        text += alphabet[(seed >> 16) % letters];
+      }
+      std::vector<std::string_view> expected(1, std::string_view{});
+      bool expected_valid = true;
+      for (size_t i = 0, start = 0; i <= length; ++i) {
+        if (i == length || text[i] == ' ') {
+          expected.back() = std::string_view{text}.substr(start, i - start);
+          if (i < length) {
+            expected.emplace_back();
+          }
+          start = i + 1;
+        } else if (static_cast<unsigned char>(text[i]) < ' ') {
+          expected_valid = false;
+        }
+      }
+      for (const TokenizerKernel kernel : GetSupportedTokenizerKernels()) {
+        std::vector<std::string_view> words;
+        ASSERT_EQUAL(TokenizeText(text, words, kernel), expected_valid);
+        ASSERT(words == expected);
+      }
+    }
+  }
+
+  // A special character past the first chunks still rejects the query
+  SearchServer server{std::string{"in"}};
+  server.AddDocument(1, "white cat in the city of lights",
+                     DocumentStatus::ACTUAL, {1});
+  ASSERT_EQUAL(server.FindTopDocuments("in the city of lights cat").size(),
+               1u);
+  try {
+    server.FindTopDocuments("in the city of lights and big \x12" "cat");
+    ASSERT_HINT(false, "Special symbols in the query must throw");
+  } catch (const std::invalid_argument &) {
+  }
+  ASSERT(SplitIntoWords(std::string{"  a  bc "}) ==
+         std::vector<std::string>({"a", "bc"}));
+}
+
+void TestAddDocumentsFromFile() {
+  const std::string path =
+      (std::filesystem::temp_directory_path() / "search_server_corpus.txt")
+          .string();
+  const std::vector<std::string> texts = {
+      "funny pet and nasty rat", "funny pet with curly hair", "",
+      "big dog and rat",         "nasty curly dog",           "lonely word",
+      ""};
+  {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    for (const std::string &text : texts) {
+      out << text << '\n';
+    }
+  }
+  // Batches of a few bytes make a batch of every line, empty lines take no
+  // ids
+  SearchServer expected{std::string{"and with"}};
+  SearchServer loaded{std::string{"and with"}};
+  int next_id = 10;
+  for (const std::string &text : texts) {
+    if (!text.empty()) {
+      expected.AddDocument(next_id++, text, DocumentStatus::ACTUAL, {});
+    }
+  }
+  ASSERT_EQUAL(AddDocumentsFromFile(loaded, path, CorpusFormat::LINES, 10, 4),
+               5u);
+  ASSERT_EQUAL(loaded.GetDocumentCount(), 5);
+  ASSERT_EQUAL(loaded.FindTopDocuments("lonely")[0].id, 14);
+  // A batch takes a document at least, even of no bytes
+  SearchServer unbatched{std::string{"and with"}};
+  ASSERT_EQUAL(
+      AddDocumentsFromFile(unbatched, path, CorpusFormat::LINES, 10, 0), 5u);
+  ASSERT_EQUAL(unbatched.FindTopDocuments("lonely")[0].id, 14);
+  for (const std::string query : {"funny rat", "curly -funny", "lonely"}) {
+    const auto expected_documents = expected.FindTopDocuments(query);
+    const auto documents = loaded.FindTopDocuments(query);
+    ASSERT_EQUAL(documents.size(), expected_documents.size());
+    for (size_t i = 0; i < documents.size(); ++i) {
+      ASSERT_EQUAL(documents[i].id, expected_documents[i].id);
+      ASSERT_EQUAL(documents[i].relevance, expected_documents[i].relevance);
+    }
+  }
+
+  // Records carry ids, statuses and ratings, the last line may lack '\n'
+  {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << "7\tACTUAL\t5 -1 8\tfunny pet\n"
+        << "3\tBANNED\t\tbanned pet\n"
+        << "4\tIRRELEVANT\t2\tother pet";
+  }
+  SearchServer records{std::string{}};
+  ASSERT_EQUAL(AddDocumentsFromFile(records, path, CorpusFormat::RECORDS), 3u);
+  const auto actual = records.FindTopDocuments("pet");
+  ASSERT_EQUAL(actual.size(), 1u);
+  ASSERT_EQUAL(actual[0].id, 7);
+  ASSERT_EQUAL(actual[0].rating, 4);
+  ASSERT_EQUAL(records.FindTopDocuments("pet", DocumentStatus::BANNED)[0].id,
+               3);
+  ASSERT_EQUAL(
+      records.FindTopDocuments("pet", DocumentStatus::IRRELEVANT)[0].rating,
+      2);
+
+  for (const std::string record :
+       {"8\tACTUAL\tfunny", "x\tACTUAL\t\tfunny", "8\tGOOD\t\tfunny",
+        "8\tACTUAL\t1,2\tfunny", "7\tACTUAL\t\tfunny"}) {
+    {
+      std::ofstream out(path, std::ios::binary | std::ios::trunc);
+      out << record << '\n';
+    }
+    try {
+      AddDocumentsFromFile(records, path, CorpusFormat::RECORDS);
+      ASSERT_HINT(false, "Malformed record must throw");
+    } catch (const std::invalid_argument &) {
+    }
+  }
+  std::remove(path.c_str());
+  try {
+    AddDocumentsFromFile(records, path);
+    ASSERT_HINT(false, "Missing corpus file must throw");
+  } catch (const std::runtime_error &) {
+  }
+  ASSERT_EQUAL(records.GetDocumentCount(), 3);
+}
+
+void TestResultCache() {
+  SearchServer cached{std::string{"and with"}};
+  SearchServer uncached{std::string{"and with"}};
+  cached.SetResultCacheSize(100);
+  for (SearchServer *server : {&cached, &uncached}) {
+    server->AddDocument(1, "funny pet and nasty rat", DocumentStatus::ACTUAL,
+                        {7, 2, 7});
+    server->AddDocument(2, "funny pet with curly hair", DocumentStatus::ACTUAL,
+                        {1, 2});
+    server->AddDocument(3, "big dog and rat", DocumentStatus::BANNED, {5});
+  }
+  const auto expect_same_results = [&](const std::string &query,
+                                       DocumentStatus status) {
+    const auto expected = uncached.FindTopDocuments(query, status);
+    const auto actual = cached.FindTopDocuments(query, status);
+    ASSERT_EQUAL(actual.size(), expected.size());
+    for (size_t i = 0; i < actual.size(); ++i) {
+      ASSERT_EQUAL(actual[i].id, expected[i].id);
+      ASSERT_EQUAL(actual[i].relevance, expected[i].relevance);
+    }
+  };
+
+  // Word order, repeats, stop words and unknown words don't change the key
+  expect_same_results("funny rat", DocumentStatus::ACTUAL);
+  expect_same_results("rat funny and funny unknown", DocumentStatus::ACTUAL);
+  ResultCache::Stats stats = cached.GetResultCacheStats();
+  ASSERT_EQUAL(stats.hits, 1u);
+  ASSERT_EQUAL(stats.misses, 1u);
+  // Other statuses, result counts and minus words are other keys
+  expect_same_results("funny rat", DocumentStatus::BANNED);
+  expect_same_results("funny rat -curly", DocumentStatus::ACTUAL);
+  ASSERT_EQUAL(cached.FindTopDocuments(std::execution::par, "funny rat",
+                                       DocumentStatus::ACTUAL, 1)
+                   .size(),
+               1u);
+  ASSERT_EQUAL(cached.GetResultCacheStats().hits, 1u);
+  // Predicates of the caller bypass the cache
+  cached.FindTopDocuments("funny rat", [](int, DocumentStatus, int) {
+    return true;
+  });
+  ASSERT_EQUAL(cached.GetResultCacheStats().misses, 4u);
+
+  // Every modification makes the cached results stale
+  for (SearchServer *server : {&cached, &uncached}) {
+    server->AddDocument(4, "funny funny rat", DocumentStatus::ACTUAL, {9});
+  }
+  expect_same_results("funny rat", DocumentStatus::ACTUAL);
+  for (SearchServer *server : {&cached, &uncached}) {
+    server->RemoveDocument(1);
+  }
+  expect_same_results("funny rat", DocumentStatus::ACTUAL);
+  for (SearchServer *server : {&cached, &uncached}) {
+    server->AddDocuments({{5, "rat rat", DocumentStatus::ACTUAL, {1}}});
+  }
+  expect_same_results("funny rat", DocumentStatus::ACTUAL);
+  expect_same_results("funny rat", DocumentStatus::ACTUAL);
+  stats = cached.GetResultCacheStats();
+  ASSERT_EQUAL(stats.stale, 3u);
+  ASSERT_EQUAL(stats.hits, 2u);
+
+  // The least recently used results make room for new ones
+  cached.SetResultCacheSize(4);
+  for (size_t i = 1; i <= 10; ++i) {
+    cached.FindTopDocuments(std::execution::seq, "funny rat",
+                            DocumentStatus::ACTUAL, i);
+  }
+  ASSERT(cached.GetResultCacheStats().evictions > 0);
+  ASSERT(cached.GetResultCacheStats().entries <= 4);
+  cached.SetResultCacheSize(0);
+  cached.FindTopDocuments("funny rat");
+  ASSERT_EQUAL(cached.GetResultCacheStats().hits, 0u);
+}
+
+void TestInverseDocumentFreqFollowsModifications() {
+  // Relevance of "cat" in document 1 is 1 / 2 * log(documents / with cat),
+  // both counts change with every modification
+  SearchServer server{std::string{""}};
+  server.AddDocument(1, "cat dog", DocumentStatus::ACTUAL, {});
+  const auto expect_relevance = [&](int document_count, int cat_count) {
+    const auto documents = server.FindTopDocuments("cat");
+    ASSERT(!documents.empty());
+    ASSERT_EQUAL(documents.back().id, 1);
+    ASSERT(std::abs(documents.back().relevance -
+                    0.5 * std::log(document_count * 1.0 / cat_count)) <
+           1e-12);
+  };
+  server.AddDocument(2, "dog", DocumentStatus::ACTUAL, {});
+  expect_relevance(2, 1);
+  server.AddDocuments({{3, "cat cat", DocumentStatus::ACTUAL, {}},
+                       {4, "bird", DocumentStatus::ACTUAL, {}},
+                       {5, "bird", DocumentStatus::ACTUAL, {}}});
+  expect_relevance(5, 2);
+  server.RemoveDocument(4);
+  expect_relevance(4, 2);
+  server.SetSoftDelete(true);
+  server.RemoveDocuments({3, 5});
+  expect_relevance(2, 1);
+  server.WaitForCompaction();
+  expect_relevance(2, 1);
+  server.AddDocument(6, "cat", DocumentStatus::ACTUAL, {});
+  expect_relevance(3, 2);
+}
+
+void TestRequiredWordsAndPhrases() {
+  const std::vector<std::string> words{"cat", "dog", "owl", "fox", "eel"};
+  SearchServer server{std::string{"and"}};
+  server.SetWriteBufferSize(64);
+  server.SetScoringConcurrency(4);
+  // Words of every document without the stop word, for the expected results
+  std::map<int, std::vector<std::string>> texts;
+  // The batch views the texts
+  std::vector<std::string> batch_texts(2000);
+  std::vector<NewDocument> batch;
+  uint32_t random = 1;
+  for (int id = 0; id < 2000; ++id) {
+    std::string &text = batch_texts[id];
+    for (int i = 0; i < 3 + id % 4; ++i) {
+      random = random * 1103515245 + 12345;
+      const std::string &word = words[random >> 16 & 3 ? random % 5 : 0];
+      texts[id].push_back(word);
+      text += word + (random >> 20 & 1 ? " and " : " ");
+    }
+    if (id < 1000) {
+      server.AddDocument(id, text, DocumentStatus::ACTUAL, {id % 10});
+    } else {
+      batch.push_back({id, text, DocumentStatus::ACTUAL, {id % 10}});
+    }
+  }
+  server.AddDocuments(std::execution::par, batch);
+
+  const auto has_phrase = [&](int id, const std::vector<std::string> &phrase) {
+    const std::vector<std::string> &text = texts.at(id);
+    return std::search(text.begin(), text.end(), phrase.begin(),
+                       phrase.end()) != text.end();
+  };
+  // Required words only filter the results of the same query without them,
+  // relevance is the same to the last bit
+  SearchServer *searched = &server;
+  const auto expect_filtered =
+      [&](const std::string &query, const std::string &plain_query,
+          const std::vector<std::vector<std::string>> &phrases) {
+    const auto expected = searched->FindTopDocuments(
+        std::execution::seq, plain_query,
+        [&](int id, DocumentStatus, int) {
+          return std::all_of(phrases.begin(), phrases.end(),
+                             [&](const std::vector<std::string> &phrase) {
+                               return has_phrase(id, phrase);
+                             });
+        },
+        10'000);
+    ASSERT(!expected.empty());
+    for (const auto &actual :
+         {searched->FindTopDocuments(std::execution::seq, query,
+                                     DocumentStatus::ACTUAL, 10'000),
+          searched->FindTopDocuments(std::execution::par, query,
+                                     DocumentStatus::ACTUAL, 10'000)}) {
+      ASSERT_EQUAL(actual.size(), expected.size());
+      for (size_t i = 0; i < actual.size(); ++i) {
+        ASSERT_EQUAL(actual[i].id, expected[i].id);
+        ASSERT_EQUAL(actual[i].relevance, expected[i].relevance);
+      }
+    }
+  };
+  const auto expect_all = [&]() {
+    expect_filtered("+dog +owl fox", "dog owl fox", {{"dog"}, {"owl"}});
+    expect_filtered("+dog +owl fox -eel", "dog owl fox -eel",
+                    {{"dog"}, {"owl"}});
+    expect_filtered("\"dog owl\" fox", "dog owl fox", {{"dog", "owl"}});
+    expect_filtered("+fox \"dog owl\"", "fox dog owl",
+                    {{"fox"}, {"dog", "owl"}});
+    // The stop word between the words doesn't break the phrase
+    expect_filtered("\"cat and cat dog\"", "cat dog", {{"cat", "cat", "dog"}});
+  };
+  expect_all();
+  server.WaitForMerges();
+  expect_all();
+  std::vector<int> removed;
+  for (int id = 0; id < 2000; id += 3) {
+    removed.push_back(id);
+    texts.erase(id);
+  }
+  server.RemoveDocuments(removed);
+  expect_all();
+  const std::string path =
+      (std::filesystem::temp_directory_path() / "search_server_phrases.bin")
+          .string();
+  server.SaveSnapshot(path);
+  SearchServer loaded{std::string{"and"}};
+  loaded.LoadSnapshot(path);
+  searched = &loaded;
+  expect_all();
+  std::remove(path.c_str());
+
+  SearchServer small{std::string{"and"}};
+  small.AddDocument(1, "cat and dog", DocumentStatus::ACTUAL, {});
+  small.AddDocument(2, "dog cat", DocumentStatus::ACTUAL, {});
+  // Unknown required words match nothing, unknown plain words are dropped
+  ASSERT(small.FindTopDocuments("+cat +bird").empty());
+  ASSERT(small.FindTopDocuments("cat \"bird dog\"").empty());
+  ASSERT_EQUAL(small.FindTopDocuments("+cat bird").size(), 2u);
+  ASSERT_EQUAL(small.FindTopDocuments("+and cat").size(), 2u);
+  const auto [matched, _] = small.MatchDocument("\"cat dog\"", 1);
+  ASSERT_EQUAL(matched.size(), 2u);
+  ASSERT(std::get<0>(small.MatchDocument("\"cat dog\"", 2)).empty());
+  ASSERT(std::get<0>(small.MatchDocument(std::execution::par, "+cat +owl", 1))
+             .empty());
+  for (const std::string query :
+       {"\"cat dog", "\"cat -dog\"", "+", "+-cat", "cat \"dog +cat\""}) {
+    try {
+      small.FindTopDocuments(query);
+      ASSERT_HINT(false, "Invalid query " + query + " wasn't rejected");
+    } catch (const std::invalid_argument &) {
+    }
+  }
+}
+
+void TestDynamicPruningMatchesExhaustiveScoring() {
+  // Skewed word frequencies, repeated texts with other ratings for ties
+  // and segments, the write buffer and removed documents to score
+  SearchServer server{std::string{"and"}};
+  server.SetWriteBufferSize(512);
+  server.SetScoringConcurrency(4);
+  uint32_t random = 7;
+  const auto next_word = [&random]() {
+    random = random * 1103515245 + 12345;
+    const uint32_t value = random >> 16 & 0x3ff;
+    return "w" + std::to_string(value * value % 997 / (1 + value % 7));
+  };
+  std::vector<std::string> texts;
+  for (int id = 0; id < 6000; ++id) {
+    if (id % 10 == 9) {
+      texts.push_back(texts[id - 1]);
+    } else {
+      std::string text;
+      for (int i = 0; i < 2 + id % 9; ++i) {
+        text += next_word() + (i % 4 == 3 ? " and " : " ");
+      }
+      texts.push_back(text);
+    }
+    server.AddDocument(id, texts.back(), DocumentStatus::ACTUAL,
+                       {id % 13, id % 3});
+  }
+  std::vector<std::string> queries;
+  for (int i = 0; i < 60; ++i) {
+    std::string query;
+    for (int j = 0; j < 1 + i % 6; ++j) {
+      query += (j == 3 ? "-" : "") + next_word() + " ";
+    }
+    queries.push_back(query + (i % 5 == 0 ? "and" : ""));
+  }
+  const auto expect_same_results = [&]() {
+    for (const std::string &query : queries) {
+      for (const size_t result_count : {1, 5, 50}) {
+        server.SetDynamicPruning(false);
+        const auto expected = server.FindTopDocuments(
+            std::execution::seq, query, DocumentStatus::ACTUAL, result_count);
+        const auto odd = [](int id, DocumentStatus, int) { return id % 2; };
+        const auto expected_odd = server.FindTopDocuments(
+            std::execution::seq, query, odd, result_count);
+        server.SetDynamicPruning(true);
+        const auto equal = [](const std::vector<Document> &lhs,
+                              const std::vector<Document> &rhs) {
+          ASSERT_EQUAL(lhs.size(), rhs.size());
+          for (size_t i = 0; i < lhs.size(); ++i) {
+            ASSERT_EQUAL(lhs[i].id, rhs[i].id);
+            ASSERT_EQUAL(lhs[i].relevance, rhs[i].relevance);
+            ASSERT_EQUAL(lhs[i].rating, rhs[i].rating);
+          }
+        };
+        equal(server.FindTopDocuments(std::execution::seq, query,
+                                      DocumentStatus::ACTUAL, result_count),
+              expected);
+        equal(server.FindTopDocuments(std::execution::par, query,
+                                      DocumentStatus::ACTUAL, result_count),
+              expected);
+        equal(server.FindTopDocuments(std::execution::seq, query, odd,
+                                      result_count),
+              expected_odd);
+      }
+    }
+  };
+  expect_same_results();
+  server.WaitForMerges();
+  std::vector<int> removed;
+  for (int id = 0; id < 6000; id += 7) {
+    removed.push_back(id);
+  }
+  server.RemoveDocuments(removed);
+  expect_same_results();
+  const std::string path =
+      (std::filesystem::temp_directory_path() / "search_server_pruning.bin")
+          .string();
+  server.SaveSnapshot(path);
+  server.LoadSnapshot(path);
+  expect_same_results();
+  std::remove(path.c_str());
+}
+
+void TestBm25Scorer() {
+  SearchServer server{std::string{"and"}};
+  server.AddDocument(0, "cat and dog", DocumentStatus::ACTUAL, {1});
+  server.AddDocument(1, "cat cat cat bird fish", DocumentStatus::ACTUAL, {2});
+  server.AddDocument(2, "dog fish", DocumentStatus::ACTUAL, {3});
+  server.AddDocument(3, "fish fish", DocumentStatus::ACTUAL, {4});
+  // Occurrences, words of the document and documents with the word
+  const auto bm25 = [](double count, double length, double document_freq,
+                       double document_count, double average_length) {
+    const double k1 = 1.2;
+    const double b = 0.75;
+    const double idf = log(1 + (document_count - document_freq + 0.5) /
+                                   (document_freq + 0.5));
+    return idf * count * (k1 + 1) /
+           (count + k1 * (1 - b + b * length / average_length));
+  };
+  const auto expect_relevance = [](const std::vector<Document> &documents,
+                                   int id, double relevance) {
+    const auto it = std::find_if(
+        documents.begin(), documents.end(),
+        [id](const Document &document) { return document.id == id; });
+    ASSERT(it != documents.end());
+    ASSERT(std::abs(it->relevance - relevance) < 1e-9);
+  };
+  {
+    const double average = 11.0 / 4;
+    const auto found = server.FindTopDocuments<Bm25Scorer>("cat fish");
+    ASSERT_EQUAL(found.size(), 4u);
+    expect_relevance(found, 0, bm25(1, 2, 2, 4, average));
+    expect_relevance(found, 1,
+                     bm25(3, 5, 2, 4, average) + bm25(1, 5, 3, 4, average));
+    expect_relevance(found, 3, bm25(2, 2, 3, 4, average));
+    // TF-IDF stays the default
+    const auto tf_idf = server.FindTopDocuments("cat fish");
+    const auto explicit_tf_idf =
+        server.FindTopDocuments<TfIdfScorer>("cat fish");
+    ASSERT_EQUAL(tf_idf.size(), explicit_tf_idf.size());
+    for (size_t i = 0; i < tf_idf.size(); ++i) {
+      ASSERT_EQUAL(tf_idf[i].id, explicit_tf_idf[i].id);
+      ASSERT_EQUAL(tf_idf[i].relevance, explicit_tf_idf[i].relevance);
+    }
+    expect_relevance(tf_idf, 3, log(4.0 / 3));
+  }
+  {
+    // Cached TF-IDF results aren't returned for BM25
+    server.SetResultCacheSize(16);
+    server.FindTopDocuments("fish");
+    const auto found = server.FindTopDocuments<Bm25Scorer>("fish");
+    expect_relevance(found, 3, bm25(2, 2, 3, 4, 11.0 / 4));
+    // The average length follows removals, required words score the same
+    server.RemoveDocument(1);
+    const double average = 6.0 / 3;
+    expect_relevance(server.FindTopDocuments<Bm25Scorer>("dog +fish"), 2,
+                     bm25(1, 2, 2, 3, average) + bm25(1, 2, 2, 3, average));
+    expect_relevance(server.FindTopDocuments<Bm25Scorer>(
+                         std::execution::par, "fish", DocumentStatus::ACTUAL),
+                     3, bm25(2, 2, 2, 3, average));
+  }
+
+  {
+    // Documents of stop words only have no length and add to the count only
+    SearchServer server{std::string{"and"}};
+    server.AddDocument(1, "and", DocumentStatus::ACTUAL, {});
+    server.AddDocument(2, "and and", DocumentStatus::ACTUAL, {});
+    server.AddDocument(3, "cat dog", DocumentStatus::ACTUAL, {});
+    const auto found = server.FindTopDocuments<Bm25Scorer>("cat and");
+    ASSERT_EQUAL(found.size(), 1u);
+    expect_relevance(found, 3, bm25(1, 2, 1, 3, 2.0 / 3));
+    ASSERT(server.GetWordFrequencies(2).empty());
+    const std::string path =
+        (std::filesystem::temp_directory_path() / "search_server_empty.bin")
+            .string();
+    server.SaveSnapshot(path);
+    SearchServer loaded{std::string{}};
+    loaded.LoadSnapshot(path);
+    ASSERT_EQUAL(loaded.GetDocumentCount(), 3);
+    const auto reloaded = loaded.FindTopDocuments<Bm25Scorer>("cat");
+    ASSERT_EQUAL(reloaded.size(), 1u);
+    ASSERT_EQUAL(reloaded[0].relevance, found[0].relevance);
+    std::remove(path.c_str());
+  }
+
+  // Pruning bounds hold for BM25 too
+  SearchServer large{std::string{""}};
+  large.SetWriteBufferSize(256);
+  uint32_t random = 11;
+  const auto next_word = [&random]() {
+    random = random * 1103515245 + 12345;
+    const uint32_t value = random >> 16 & 0xff;
+    return "w" + std::to_string(value * value % 251 / (1 + value % 5));
+  };
+  std::vector<std::string> texts;
+  for (int id = 0; id < 3000; ++id) {
+    std::string text;
+    for (int i = 0; i < 1 + id % 17; ++i) {
+      text += next_word() + " ";
+    }
+    texts.push_back(text);
+    large.AddDocument(id, texts.back(), DocumentStatus::ACTUAL, {id % 5});
+  }
+  for (int i = 0; i < 40; ++i) {
+    std::string query;
+    for (int j = 0; j < 1 + i % 5; ++j) {
+      query += next_word() + " ";
+    }
+    large.SetDynamicPruning(false);
+    const auto expected = large.FindTopDocuments<Bm25Scorer>(
+        std::execution::seq, query, DocumentStatus::ACTUAL, 10);
+    large.SetDynamicPruning(true);
+    const auto actual = large.FindTopDocuments<Bm25Scorer>(
+        std::execution::seq, query, DocumentStatus::ACTUAL, 10);
+    ASSERT_EQUAL(actual.size(), expected.size());
+    for (size_t k = 0; k < actual.size(); ++k) {
+      ASSERT_EQUAL(actual[k].id, expected[k].id);
+      ASSERT_EQUAL(actual[k].relevance, expected[k].relevance);
+    }
+  }
+}
+
+void TestDocumentFilter() {
+  SearchServer server{std::string{"and"}};
+  server.SetWriteBufferSize(300);
+  const std::vector<std::string> words{"cat", "dog", "bird", "fish", "mouse",
+                                       "horse", "cow", "duck"};
+  std::vector<std::string> texts;
+  for (int id = 0; id < 2000; ++id) {
+    std::string text;
+    for (int i = 0; i < 2 + id % 5; ++i) {
+      text += words[(id * 7 + i * i * 3) % words.size()] + " ";
+    }
+    texts.push_back(text);
+    server.AddDocument(id * 3, texts.back(),
+                       static_cast<DocumentStatus>(id % 4), {id % 11 - 5});
+  }
+  DocumentFilter any_status;
+  any_status.statuses = DocumentFilter::GetStatusBit(DocumentStatus::ACTUAL) |
+                        DocumentFilter::GetStatusBit(DocumentStatus::BANNED) |
+                        DocumentFilter::GetStatusBit(DocumentStatus::REMOVED) |
+                        DocumentFilter::GetStatusBit(
+                            DocumentStatus::IRRELEVANT);
+  DocumentFilter ratings{DocumentStatus::BANNED};
+  ratings.min_rating = -2;
+  ratings.max_rating = 3;
+  DocumentFilter ids = any_status;
+  ids.min_document_id = 1000;
+  ids.max_document_id = 4000;
+  ids.max_rating = 0;
+  DocumentFilter nothing;
+  nothing.statuses = 0;
+  // Bits past the last status are ignored
+  DocumentFilter unknown_status;
+  unknown_status.statuses = 1u << 20;
+  DocumentFilter actual_and_unknown;
+  actual_and_unknown.statuses |= 1u << 31;
+  const std::vector<DocumentFilter> filters{
+      DocumentFilter(), any_status, ratings, ids, nothing, unknown_status,
+      actual_and_unknown};
+  const std::vector<std::string> queries{"cat", "dog fish -cow", "+bird duck",
+                                         "horse mouse cow duck"};
+  const auto expect_same_results = [&]() {
+    for (const DocumentFilter &filter : filters) {
+      const auto predicate = [&filter](int id, DocumentStatus status,
+                                       int rating) {
+        return filter.Matches(id, status, rating);
+      };
+      for (const std::string &query : queries) {
+        const auto expected = server.FindTopDocuments(std::execution::seq,
+                                                      query, predicate, 20);
+        for (const auto &actual :
+             {server.FindTopDocuments(std::execution::seq, query, filter, 20),
+              server.FindTopDocuments(std::execution::par, query, filter,
+                                      20)}) {
+          ASSERT_EQUAL(actual.size(), expected.size());
+          for (size_t i = 0; i < actual.size(); ++i) {
+            ASSERT_EQUAL(actual[i].id, expected[i].id);
+            ASSERT_EQUAL(actual[i].relevance, expected[i].relevance);
+          }
+        }
+      }
+    }
+  };
+  expect_same_results();
+  ASSERT(server.FindTopDocuments("cat", nothing).empty());
+  ASSERT(server.FindTopDocuments(std::execution::par, "cat", unknown_status)
+             .empty());
+  // Status queries are filtered by the bitmaps too and removals clear them
+  server.SetResultCacheSize(8);
+  server.SetDynamicPruning(false);
+  for (int id = 0; id < 6000; id += 15) {
+    server.RemoveDocument(id);
+  }
+  expect_same_results();
+  const DocumentFilter banned(DocumentStatus::BANNED);
+  ASSERT_EQUAL(server.FindTopDocuments("cat", DocumentStatus::BANNED).size(),
+               server.FindTopDocuments("cat", banned).size());
+  const std::string path =
+      (std::filesystem::temp_directory_path() / "search_server_filter.bin")
+          .string();
+  server.SaveSnapshot(path);
+  server.LoadSnapshot(path);
+  server.SetDynamicPruning(true);
+  expect_same_results();
+  std::remove(path.c_str());
+}
+
 const class TestSearchServer {
 public:
   TestSearchServer() {
@@ -232,5 +1789,29 @@ public:
     RUN_TEST(TestSearchWithPredicate);
     RUN_TEST(TestSearchDocumentsByStatus);
     RUN_TEST(TestCalculatedRelevance);
+    RUN_TEST(TestRemoveAndAddDocumentAgain);
+    RUN_TEST(TestFindTopDocumentsResultCount);
+    RUN_TEST(TestFindTopDocumentsPages);
+    RUN_TEST(TestParallelSearchMatchesSequential);
+    RUN_TEST(TestWorkStealingPool);
+    RUN_TEST(TestWordFrequenciesAndUnknownWords);
+    RUN_TEST(TestRemovedDocumentsFreeWords);
+    RUN_TEST(TestRemoveDocumentsBatch);
+    RUN_TEST(TestSoftDeleteWithBackgroundCompaction);
+    RUN_TEST(TestFindDuplicates);
+    RUN_TEST(TestSnapshotSaveAndLoad);
+    RUN_TEST(TestMutationLogReplay);
+    RUN_TEST(TestAddDocumentsBatch);
+    RUN_TEST(TestConcurrentQueriesAndUpdates);
+    RUN_TEST(TestSegmentedIndex);
+    RUN_TEST(TestCompressedPostings);
+    RUN_TEST(TestTokenizer);
+    RUN_TEST(TestAddDocumentsFromFile);
+    RUN_TEST(TestResultCache);
+    RUN_TEST(TestInverseDocumentFreqFollowsModifications);
+    RUN_TEST(TestRequiredWordsAndPhrases);
+    RUN_TEST(TestDynamicPruningMatchesExhaustiveScoring);
+    RUN_TEST(TestBm25Scorer);
+    RUN_TEST(TestDocumentFilter);
   }
 } TEST_SEARCHSERVER;
\ No newline at end of file
@@ -27,7 +27,7 @@ void AssertImpl(const T &t, const std::string &t_str, const std::string &file,
   }
 }
 
-#define ASSERT(a) AssertImpl((a), #a, __FILE__, __FUNCTION__, __LINE__, ""s)
+#define ASSERT(a) AssertImpl((a), #a, __FILE__, __FUNCTION__, __LINE__, "")
 
 #define ASSERT_HINT(a, hint)                                                   \
   AssertImpl((a), #a, __FILE__, __FUNCTION__, __LINE__, (hint))
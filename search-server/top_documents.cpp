@@ -0,0 +1,50 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "top_documents.h"
+
+TopDocuments::TopDocuments(size_t capacity) : capacity_(capacity) {}
+
+void TopDocuments::Add(const Document &document) {
+  if (heap_.size() < capacity_) {
+    heap_.push_back(document);
+    std::push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+    return;
+  }
+  // heap_.front() is the least relevant of the kept documents
+  if (capacity_ == 0 || !IsMoreRelevant(document, heap_.front())) {
+    return;
+  }
+  std::pop_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+  heap_.back() = document;
+  std::push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+}
+
+double TopDocuments::GetMinRelevanceToKeep() const {
+  if (capacity_ == 0) {
+    return std::numeric_limits<double>::infinity();
+  }
+  if (heap_.size() < capacity_) {
+    return -std::numeric_limits<double>::infinity();
+  }
+  // Documents of almost equal relevance are ranked by rating and id, the
+  // margin is twice the one of AlmostEqualRelative
+  const double min_relevance = heap_.front().relevance;
+  return min_relevance - std::abs(min_relevance) * 2 * DBL_EPSILON;
+}
+
+void TopDocuments::Merge(const TopDocuments &other) {
+  for (const Document &document : other.heap_) {
+    Add(document);
+  }
+}
+
+size_t TopDocuments::size() const { return heap_.size(); }
+
+std::vector<Document> TopDocuments::Extract() {
+  std::sort_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+  std::vector<Document> result = std::move(heap_);
+  heap_.clear();
+  return result;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "document.h"
+
+// Keeps the capacity most relevant documents out of everything added to it
+// (ranking order of IsMoreRelevant). The least relevant kept document sits
+// on top of a heap, so Add is O(log capacity) and usually O(1) for documents
+// that don't make it into the top.
+class TopDocuments {
+public:
+  explicit TopDocuments(size_t capacity);
+
+  void Add(const Document &document);
+  // Documents of lower relevance aren't kept, whatever their rating and id
+  // are. Grows as better documents come
+  double GetMinRelevanceToKeep() const;
+  // Adds every document kept by other
+  void Merge(const TopDocuments &other);
+
+  size_t size() const;
+
+  // Returns the kept documents, most relevant first. Leaves the object empty
+  std::vector<Document> Extract();
+
+private:
+  size_t capacity_;
+  std::vector<Document> heap_;
+};
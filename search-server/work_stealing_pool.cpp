@@ -0,0 +1,127 @@
+#include <algorithm>
+
+#include "work_stealing_pool.h"
+
+WorkStealingPool::WorkStealingPool(size_t worker_count) {
+  for (size_t i = 0; i < worker_count; ++i) {
+    queues_.push_back(std::make_unique<TaskQueue>());
+  }
+  for (size_t i = 0; i < worker_count; ++i) {
+    workers_.emplace_back([this, i] { WorkerLoop(i); });
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard guard(wake_mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (std::thread &worker : workers_) {
+    worker.join();
+  }
+}
+
+size_t WorkStealingPool::GetConcurrency() const { return workers_.size() + 1; }
+
+void WorkStealingPool::ParallelFor(size_t task_count,
+                                   const std::function<void(size_t)> &body) {
+  if (queues_.empty() || task_count <= 1) {
+    for (size_t i = 0; i < task_count; ++i) {
+      body(i);
+    }
+    return;
+  }
+  Job job;
+  job.body = &body;
+  job.remaining = task_count;
+  // Counting the tasks before queueing them, a worker may take one right away
+  {
+    std::lock_guard guard(wake_mutex_);
+    queued_tasks_ += task_count;
+  }
+  for (size_t i = 0; i < task_count; ++i) {
+    TaskQueue &queue = *queues_[i % queues_.size()];
+    std::lock_guard guard(queue.mutex);
+    queue.tasks.push_back({&job, i});
+  }
+  wake_.notify_all();
+
+  // Helping the workers until every task of the job is taken, then waiting
+  // for the ones still running
+  while (job.remaining > 0) {
+    if (!RunTask(0)) {
+      std::unique_lock lock(wake_mutex_);
+      job_done_.wait(lock, [&job] { return job.remaining == 0; });
+    }
+  }
+  if (job.error) {
+    std::rethrow_exception(job.error);
+  }
+}
+
+std::shared_ptr<WorkStealingPool> WorkStealingPool::GetDefault() {
+  static const std::shared_ptr<WorkStealingPool> pool =
+      std::make_shared<WorkStealingPool>(
+          std::max(1u, std::thread::hardware_concurrency()) - 1);
+  return pool;
+}
+
+void WorkStealingPool::WorkerLoop(size_t queue_index) {
+  while (true) {
+    if (RunTask(queue_index)) {
+      continue;
+    }
+    std::unique_lock lock(wake_mutex_);
+    wake_.wait(lock, [this] { return stopping_ || queued_tasks_ > 0; });
+    if (stopping_) {
+      return;
+    }
+  }
+}
+
+bool WorkStealingPool::RunTask(size_t home_index) {
+  for (size_t i = 0; i < queues_.size(); ++i) {
+    TaskQueue &queue = *queues_[(home_index + i) % queues_.size()];
+    std::unique_lock lock(queue.mutex);
+    if (queue.tasks.empty()) {
+      continue;
+    }
+    // Own queue is served from the front, victims are robbed from the back
+    Task task;
+    if (i == 0) {
+      task = queue.tasks.front();
+      queue.tasks.pop_front();
+    } else {
+      task = queue.tasks.back();
+      queue.tasks.pop_back();
+    }
+    lock.unlock();
+    --queued_tasks_;
+    Execute(task);
+    return true;
+  }
+  return false;
+}
+
+void WorkStealingPool::Execute(const Task &task) {
+  Job &job = *task.job;
+  // Tasks of a failed job are only counted down
+  if (!job.failed) {
+    try {
+      (*job.body)(task.index);
+    } catch (...) {
+      std::lock_guard guard(job.error_mutex);
+      if (!job.error) {
+        job.error = std::current_exception();
+      }
+      job.failed = true;
+    }
+  }
+  if (--job.remaining == 0) {
+    // Taking the lock so the notification can't slip in between the check
+    // and the wait of ParallelFor
+    std::lock_guard guard(wake_mutex_);
+    job_done_.notify_all();
+  }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads, every worker owns a task queue. A worker takes
+// tasks from the front of its own queue and, when it runs dry, steals from
+// the back of the others, so uneven tasks don't leave threads idle.
+// The thread calling ParallelFor executes tasks too, which also makes nested
+// ParallelFor calls from inside a task safe.
+class WorkStealingPool {
+public:
+  // worker_count may be 0, then ParallelFor runs on the calling thread
+  explicit WorkStealingPool(size_t worker_count);
+  ~WorkStealingPool();
+
+  WorkStealingPool(const WorkStealingPool &) = delete;
+  WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+  // Number of threads executing tasks of a ParallelFor, including the caller
+  size_t GetConcurrency() const;
+
+  // Calls body(i) for every i in [0, task_count) and returns when all calls
+  // have finished. If a call throws, the tasks not started yet are skipped
+  // and the first exception is rethrown on the calling thread
+  void ParallelFor(size_t task_count, const std::function<void(size_t)> &body);
+
+  // Pool shared by everyone who doesn't need a specific thread count, has a
+  // thread per hardware thread
+  static std::shared_ptr<WorkStealingPool> GetDefault();
+
+private:
+  struct Job {
+    const std::function<void(size_t)> *body = nullptr;
+    std::atomic<size_t> remaining = 0;
+    std::atomic<bool> failed = false;
+    std::mutex error_mutex;
+    std::exception_ptr error; // the first exception of the body
+  };
+
+  struct Task {
+    Job *job;
+    size_t index;
+  };
+
+  struct TaskQueue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  std::vector<std::unique_ptr<TaskQueue>> queues_;
+  std::vector<std::thread> workers_;
+  std::mutex wake_mutex_;
+  std::condition_variable wake_;
+  std::condition_variable job_done_;
+  std::atomic<size_t> queued_tasks_ = 0;
+  bool stopping_ = false;
+
+  void WorkerLoop(size_t queue_index);
+  // Runs one task from queue home_index or stolen from another queue.
+  // Returns false if every queue is empty
+  bool RunTask(size_t home_index);
+  void Execute(const Task &task);
+};